@@ -0,0 +1,761 @@
+#include "Benchmark.h"
+
+#include <atomic>
+#include <fstream>
+#include <new>
+
+#include "StubGL.h"
+#include "HighResolutionTimer.h"
+#include "CatmullRom.h"
+#include "MatrixStack.h"
+#include "Camera.h"
+#include "Shaders.h"
+#include "PickupPlacer.h"
+#include "EntityStore.h"
+#include "TrackBroadphase.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "CpuFeatures.h"
+
+// Heap allocation counter.  The global operator new is replaced so that the harness can report allocations per operation;
+// operator new[] and the other forms forward to these in the standard library.  The replacement is linked into the game
+// as well, so it only counts while Measure has switched counting on:  outside a -bench run an allocation costs one
+// relaxed load more than the library's operator new.  Counting is not per thread, so work a benchmark hands to the job
+// system's workers is counted too.
+static std::atomic<long long> g_allocationCount(0);
+static std::atomic<bool> g_countAllocations(false);
+
+void* operator new(size_t size)
+{
+	if (g_countAllocations.load(std::memory_order_relaxed))
+		g_allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+	// As the standard operator new:  call the new handler, if there is one, until the allocation succeeds
+	for (;;) {
+		void* p = malloc(size ? size : 1);
+		if (p != NULL)
+			return p;
+		std::new_handler handler = std::get_new_handler();
+		if (handler == NULL)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+// Results are written here so the compiler cannot remove the benchmarked work
+static volatile float g_sink;
+
+static const int NUM_DISTANCES = 4096;		// Power of two, indexed with a mask
+static const double MIN_RUN_TIME = 50.0;	// Milliseconds a measured run must last
+static const int NUM_RUNS = 5;				// Runs per benchmark; the fastest is reported
+static const int BATCH_SIZE = 1024;			// Samples per batched spline operation
+
+// Shared fixtures, built once in SetUpFixtures
+static CCatmullRom* g_pTrack = NULL;
+static float g_distances[NUM_DISTANCES];
+static glm::vec3 g_queryPoints[NUM_DISTANCES];
+static CShaderProgram g_program;
+static float g_batchDistances[BATCH_SIZE];
+static float g_batchX[BATCH_SIZE], g_batchY[BATCH_SIZE], g_batchZ[BATCH_SIZE];
+static float g_batchTX[BATCH_SIZE], g_batchTY[BATCH_SIZE], g_batchTZ[BATCH_SIZE];
+static CFrustum g_frustum;
+static SphereList g_spheres;
+
+static void SetUpFixtures()
+{
+	if (g_pTrack != NULL)
+		return;
+
+	g_pTrack = new CCatmullRom;
+	g_pTrack->ComputeCentreline();
+
+	// Distances spread over several laps in a scattered but repeatable order
+	unsigned int state = 12345u;
+	for (int i = 0; i < NUM_DISTANCES; i++) {
+		state = state * 1664525u + 1013904223u;
+		g_distances[i] = (state >> 8) * (10000.0f / 16777216.0f);
+	}
+
+	// Points scattered across and above the road, for projecting back onto the track
+	for (int i = 0; i < NUM_DISTANCES; i++) {
+		CurveFrame frame;
+		g_pTrack->SampleFrame(g_distances[i], frame);
+		state = state * 1664525u + 1013904223u;
+		float side = (state >> 8) * (40.0f / 16777216.0f) - 20.0f;
+		state = state * 1664525u + 1013904223u;
+		float up = (state >> 8) * (10.0f / 16777216.0f);
+		g_queryPoints[i] = frame.position + side * frame.Side() + up * frame.Up();
+	}
+
+	for (int i = 0; i < BATCH_SIZE; i++)
+		g_batchDistances[i] = i * 2.5f;
+
+	// A camera on the track looking along it, and a pickup-sized sphere at each query point
+	CCamera camera;
+	CurveFrame frame;
+	g_pTrack->SampleFrame(0.0f, frame);
+	camera.Set(frame.position + 5.0f * frame.Up(), frame.position + frame.Tangent(), frame.Up());
+	camera.SetPerspectiveProjectionMatrix(glm::radians(45.0f), 16.0f / 9.0f, 0.5f, 5000.0f);
+	glm::vec4 planes[NUM_FRUSTUM_PLANES];
+	camera.GetFrustumPlanes(planes);
+	g_frustum.SetPlanes(planes);
+	for (int i = 0; i < NUM_DISTANCES; i++)
+		g_spheres.Add(BoundingSphere(g_queryPoints[i], 2.0f));
+
+	g_program.CreateProgram();
+	g_program.LinkProgram();
+}
+
+// The SIMD kernels must give the same samples as the scalar one, to within rounding, for sorted distances and for
+// scattered ones over several laps
+static bool CheckSampleBatchKernels()
+{
+	static const float TOLERANCE = 1e-2f;
+	SampleBatchKernel kernels[] = { SampleBatchSse, SampleBatchAvx };
+	const float* distances[] = { g_batchDistances, g_distances };
+
+	for (int k = INSTRUCTION_SET_SSE; k <= GetInstructionSet(); k++) {
+		for (int d = 0; d < 2; d++) {
+			static float expected[6][BATCH_SIZE], actual[6][BATCH_SIZE];
+			g_pTrack->SampleBatch(SampleBatchScalar, distances[d], BATCH_SIZE, expected[0], expected[1], expected[2],
+				expected[3], expected[4], expected[5]);
+			g_pTrack->SampleBatch(kernels[k - INSTRUCTION_SET_SSE], distances[d], BATCH_SIZE, actual[0], actual[1], actual[2],
+				actual[3], actual[4], actual[5]);
+			for (int c = 0; c < 6; c++) {
+				for (int i = 0; i < BATCH_SIZE; i++) {
+					if (fabsf(actual[c][i] - expected[c][i]) > TOLERANCE) {
+						fprintf(stderr, "SampleBatch %s kernel differs from scalar at distance %.3f\n",
+							InstructionSetName((InstructionSet)k), distances[d][i]);
+						return false;
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+// The SIMD cull kernels must keep the same spheres as the scalar one.  They add the terms in a different order, so a
+// sphere within rounding of a plane may go either way; only spheres clear of every plane by CULL_TOLERANCE are compared.
+static bool CheckCullSpheresKernels()
+{
+	static const float CULL_TOLERANCE = 1e-3f;
+	CullSpheresKernel kernels[] = { CullSpheresSse, CullSpheresAvx };
+	SphereList expected = g_spheres, actual = g_spheres;
+	g_frustum.Cull(CullSpheresScalar, expected);
+	for (int k = INSTRUCTION_SET_SSE; k <= GetInstructionSet(); k++) {
+		g_frustum.Cull(kernels[k - INSTRUCTION_SET_SSE], actual);
+		for (size_t i = 0; i < g_spheres.Size(); i++) {
+			glm::vec3 centre(g_spheres.x[i], g_spheres.y[i], g_spheres.z[i]);
+			float radius = g_spheres.radius[i];
+			bool clear = g_frustum.IsVisible(BoundingSphere(centre, radius + CULL_TOLERANCE)) ==
+				g_frustum.IsVisible(BoundingSphere(centre, radius - CULL_TOLERANCE));
+			if (clear && actual.visible[i] != expected.visible[i]) {
+				fprintf(stderr, "Frustum::Cull %s kernel differs from scalar at (%.3f, %.3f, %.3f)\n",
+					InstructionSetName((InstructionSet)k), centre.x, centre.y, centre.z);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// A warm started projection must give the same answer as a cold one, for a point moving steadily along the track that
+// now and then jumps to one of the scattered query points, as after a respawn
+static bool CheckProjectWarmStart()
+{
+	TrackProjection warm, cold;
+	g_pTrack->Project(g_queryPoints[0], warm);
+	CurveFrame frame;
+	for (int i = 0; i < NUM_DISTANCES; i++) {
+		glm::vec3 q = g_queryPoints[i];
+		if (i % 64 != 63) {
+			g_pTrack->SampleFrame(i * 2.0f, frame);
+			q = frame.position + 15.0f * frame.Side() + 2.0f * frame.Up();
+		}
+		g_pTrack->Project(q, warm, true);
+		g_pTrack->Project(q, cold);
+		if (warm.segment != cold.segment || warm.t != cold.t) {
+			fprintf(stderr, "CatmullRom::Project with warm start differs at (%.3f, %.3f, %.3f)\n", q.x, q.y, q.z);
+			return false;
+		}
+	}
+	return true;
+}
+
+static void BenchCatmullRomSample(int numIterations)
+{
+	glm::vec3 p;
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->Sample(g_distances[i & (NUM_DISTANCES - 1)], p);
+		g_sink = p.x;
+	}
+}
+
+// A follower moving forward along the track, as in Game::UpdateSimulation
+static void BenchCatmullRomSampleCursor(int numIterations)
+{
+	glm::vec3 p;
+	int cursor = -1;
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->Sample((i & 65535) * 0.5f, cursor, p);
+		g_sink = p.x;
+	}
+}
+
+// Position, tangent and curvature from one call, as used for each follower in Game::UpdateSimulation
+static void BenchCatmullRomSampleDerivatives(int numIterations)
+{
+	CurveSample sample;
+	int cursor = -1;
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->Sample((i & 65535) * 0.5f, cursor, sample);
+		g_sink = sample.curvature;
+	}
+}
+
+// Position and orientation from the frame table, as used for each follower in Game::UpdateSimulation
+static void BenchCatmullRomSampleFrame(int numIterations)
+{
+	CurveFrame frame;
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->SampleFrame((i & 65535) * 0.5f, frame);
+		g_sink = frame.position.x;
+	}
+}
+
+static void BenchCatmullRomProject(int numIterations)
+{
+	TrackProjection projection;
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->Project(g_queryPoints[i & (NUM_DISTANCES - 1)], projection);
+		g_sink = projection.distance;
+	}
+}
+
+// A point moving steadily along the track, warm started from its previous projection as a follower would be
+static void BenchCatmullRomProjectWarm(int numIterations)
+{
+	TrackProjection projection;
+	g_pTrack->Project(g_queryPoints[0], projection);
+	CurveFrame frame;
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->SampleFrame((i & 65535) * 0.5f, frame);
+		g_pTrack->Project(frame.position + 5.0f * frame.Side() + 2.0f * frame.Up(), projection, true);
+		g_sink = projection.distance;
+	}
+}
+
+static void BenchCatmullRomComputeOffsetCurves(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++)
+		g_pTrack->ComputeOffsetCurves();
+}
+
+static void BenchCatmullRomComputeTrackMesh(int numIterations)
+{
+	vector<TrackProfilePoint> profile = CCatmullRom::DefaultTrackProfile();
+	for (int i = 0; i < numIterations; i++)
+		g_pTrack->ComputeTrackMesh(profile);
+}
+
+// One streamed chunk:  50 rings of the default profile, as CTrackStreamer builds when a chunk enters its window
+static void BenchCatmullRomComputeTrackRings(int numIterations)
+{
+	vector<TrackProfilePoint> profile = CCatmullRom::DefaultTrackProfile();
+	vector<TrackVertex> vertices;
+	for (int i = 0; i < numIterations; i++) {
+		vertices.clear();
+		g_pTrack->ComputeTrackRings(profile, (i & 7) * 250.0f, 5.0f, 51, vertices);
+	}
+}
+
+// BATCH_SIZE sorted samples per operation, one at a time and then batched, as when building a mesh along the track
+static void BenchCatmullRomSample1024(int numIterations)
+{
+	glm::vec3 p;
+	for (int i = 0; i < numIterations; i++) {
+		int cursor = -1;
+		for (int j = 0; j < BATCH_SIZE; j++) {
+			g_pTrack->Sample(g_batchDistances[j], cursor, p);
+			g_batchX[j] = p.x;
+		}
+		g_sink = g_batchX[i & (BATCH_SIZE - 1)];
+	}
+}
+
+static void BenchCatmullRomSampleBatch1024(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->SampleBatch(g_batchDistances, BATCH_SIZE, g_batchX, g_batchY, g_batchZ, g_batchTX, g_batchTY, g_batchTZ);
+		g_sink = g_batchX[i & (BATCH_SIZE - 1)];
+	}
+}
+
+// One kernel on its own, whichever SampleBatch would choose, to compare the instruction sets
+template <SampleBatchKernel KERNEL>
+static void BenchCatmullRomSampleBatchKernel1024(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++) {
+		g_pTrack->SampleBatch(KERNEL, g_batchDistances, BATCH_SIZE, g_batchX, g_batchY, g_batchZ, g_batchTX, g_batchTY, g_batchTZ);
+		g_sink = g_batchX[i & (BATCH_SIZE - 1)];
+	}
+}
+
+static void BenchCatmullRomInterpolate(int numIterations)
+{
+	glm::vec3 p0(-350, 0.5, -350), p1(150, 0.5, -250), p2(350, 0.5, -10), p3(100, 0.5, 50);
+	for (int i = 0; i < numIterations; i++) {
+		glm::vec3 p = g_pTrack->Interpolate(p0, p1, p2, p3, (i & 1023) / 1024.0f);
+		g_sink = p.x;
+	}
+}
+
+// ComputeCentreline is SetControlPoints followed by UniformlySampleControlPoints(500)
+static void BenchCatmullRomUniformlySample(int numIterations)
+{
+	CCatmullRom track;
+	track.SetParameterisation(CCatmullRom::CHORD_LENGTH);
+	glm::vec3 p;
+	for (int i = 0; i < numIterations; i++) {
+		track.ComputeCentreline();
+		track.Sample(0.0f, p);
+		g_sink = p.x;
+	}
+}
+
+// The arc-length table is built from the control points, then the display centreline is sampled once
+static void BenchCatmullRomComputeArcLengthCentreline(int numIterations)
+{
+	CCatmullRom track;
+	glm::vec3 p;
+	for (int i = 0; i < numIterations; i++) {
+		track.ComputeCentreline();
+		track.Sample(0.0f, p);
+		g_sink = p.x;
+	}
+}
+
+// Ten thousand pickups on a long track, ten units apart
+static void BenchPickupPlacerPlace10000(int numIterations)
+{
+	CPickupPlacer placer;
+	vector<PickupPlacement> placements;
+	for (int i = 0; i < numIterations; i++) {
+		placer.Place(i, 10000, 10.0f, 100000.0f, 13.0f, placements);
+		g_sink = placements.back().distance;
+	}
+}
+
+// Creating and destroying a pickup in a store that already holds many, as when pickups are collected and respawned
+static void BenchEntityStoreCreateDestroy(int numIterations)
+{
+	CEntityStore store;
+	for (int i = 0; i < 100000; i++)
+		store.Create(ENTITY_ROCK, glm::vec3((float)i), (float)i, 0.0f);
+	for (int i = 0; i < numIterations; i++) {
+		EntityHandle handle = store.Create(ENTITY_DIAMOND, glm::vec3(0.0f), 0.0f, 0.0f);
+		store.Destroy(store.Handle(ENTITY_ROCK, i % store.Count(ENTITY_ROCK)));
+		store.Create(ENTITY_ROCK, glm::vec3((float)i), (float)i, 0.0f);
+		store.Destroy(handle);
+	}
+	g_sink = (float)store.Count(ENTITY_ROCK);
+}
+
+// The collision test in Game::UpdateSimulation, against 100k rocks
+static void BenchEntityStoreScan100k(int numIterations)
+{
+	static CEntityStore* pStore = NULL;
+	if (pStore == NULL) {
+		pStore = new CEntityStore;
+		for (int i = 0; i < 100000; i++)
+			pStore->Create(ENTITY_ROCK, glm::vec3(g_distances[i & (NUM_DISTANCES - 1)], 0.0f, (float)i), 0.0f, 0.0f);
+	}
+	const EntityArchetype& rocks = pStore->Archetype(ENTITY_ROCK);
+	for (int i = 0; i < numIterations; i++) {
+		glm::vec3 q(g_distances[i & (NUM_DISTANCES - 1)], 0.0f, -10.0f);
+		int numHits = 0;
+		for (int j = 0; j < rocks.Count(); j++) {
+			if (glm::length(rocks.positions[j] - q) < 6.0f)
+				numHits++;
+		}
+		g_sink = (float)numHits;
+	}
+}
+
+// The same test through the broadphase:  only the rocks within twice the contact distance along the track
+static void BenchTrackBroadphaseQuery100k(int numIterations)
+{
+	static CEntityStore* pStore = NULL;
+	static CTrackBroadphase* pBroadphase = NULL;
+	if (pStore == NULL) {
+		pStore = new CEntityStore;
+		for (int i = 0; i < 100000; i++) {
+			float d = g_distances[i & (NUM_DISTANCES - 1)] * 10.0f + i * 0.001f;
+			pStore->Create(ENTITY_ROCK, glm::vec3(d, 0.0f, 0.0f), d, 0.0f);
+		}
+		pBroadphase = new CTrackBroadphase;
+		pBroadphase->Build(*pStore, 100000.0f);
+	}
+	vector<EntityHandle> candidates;
+	for (int i = 0; i < numIterations; i++) {
+		float d = g_distances[i & (NUM_DISTANCES - 1)] * 10.0f;
+		candidates.clear();
+		pBroadphase->Query(ENTITY_ROCK, d, 12.0f, *pStore, candidates);
+		int numHits = 0;
+		for (size_t j = 0; j < candidates.size(); j++) {
+			if (glm::length(pStore->Position(candidates[j]) - glm::vec3(d, 0.0f, 0.0f)) < 6.0f)
+				numHits++;
+		}
+		g_sink = (float)numHits;
+	}
+}
+
+// Overhead of one job:  run it from this thread, and wait for it while helping
+static void BenchJobSystemRunWait(int numIterations)
+{
+	CJobSystem& jobSystem = CJobSystem::GetInstance();
+	CJobCounter counter;
+	for (int i = 0; i < numIterations; i++) {
+		jobSystem.Run([i]() { g_sink = (float)i; }, &counter);
+		jobSystem.Wait(counter);
+	}
+}
+
+// Frame lookups for 65536 points along the track, in ranges of 1024, with NUM_THREADS threads including this one.
+// Comparing the thread counts shows how the job system scales.
+template <int NUM_THREADS>
+static void BenchJobSystemParallelFor(int numIterations)
+{
+	CJobSystem& jobSystem = CJobSystem::GetInstance();
+	if (jobSystem.GetNumWorkers() != NUM_THREADS - 1)
+		jobSystem.Start(NUM_THREADS - 1);
+
+	static float positions[65536];
+	for (int i = 0; i < numIterations; i++) {
+		jobSystem.ParallelFor(65536, 1024, [](int begin, int end) {
+			CurveFrame frame;
+			for (int j = begin; j < end; j++) {
+				g_pTrack->SampleFrame(j * 0.25f, frame);
+				positions[j] = frame.position.x;
+			}
+		});
+		g_sink = positions[i & 65535];
+	}
+}
+
+// A frame of ten thousand draws over two programs, four materials and 64 VAOs, submitted in scattered order and sorted
+static void BenchRenderQueueSubmitSort10000(int numIterations)
+{
+	static CShaderProgram otherProgram;
+	CRenderQueue queue;
+	MaterialUniforms material = {};
+	for (int i = 0; i < numIterations; i++) {
+		queue.Begin(5000.0f);
+		for (int m = 0; m < 4; m++)
+			queue.AddMaterial(material);
+		for (int j = 0; j < 10000; j++) {
+			float d = g_distances[j & (NUM_DISTANCES - 1)];
+			queue.SetProgram((j & 7) == 0 ? &otherProgram : &g_program);
+			queue.SetMaterial((j >> 3) & 3);
+			glm::mat4 modelViewMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -d * 0.5f));
+			queue.Submit(1 + (GLuint)(d * 64.0f / 10000.0f), NULL, GL_TRIANGLES, 0, 36, 0, modelViewMatrix);
+		}
+		queue.Sort();
+		g_sink = (float)queue.GetNumDraws();
+	}
+}
+
+static void BenchFrustumIsVisible(int numIterations)
+{
+	int visible = 0;
+	for (int i = 0; i < numIterations; i++) {
+		int j = i & (NUM_DISTANCES - 1);
+		visible += g_frustum.IsVisible(BoundingSphere(g_queryPoints[j], 2.0f)) ? 1 : 0;
+	}
+	g_sink = (float)visible;
+}
+
+static void BenchFrustumCull4096(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++) {
+		g_frustum.Cull(g_spheres);
+		g_sink = g_spheres.visible[i & (NUM_DISTANCES - 1)];
+	}
+}
+
+// One kernel on its own, whichever Cull would choose, to compare the instruction sets
+template <CullSpheresKernel KERNEL>
+static void BenchFrustumCullKernel4096(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++) {
+		g_frustum.Cull(KERNEL, g_spheres);
+		g_sink = g_spheres.visible[i & (NUM_DISTANCES - 1)];
+	}
+}
+
+static void BenchMatrixStackPushTranslateRotatePop(int numIterations)
+{
+	glutil::MatrixStack modelViewMatrixStack;
+	for (int i = 0; i < numIterations; i++) {
+		modelViewMatrixStack.Push();
+		modelViewMatrixStack.Translate(glm::vec3((float) (i & 255), 0.0f, 1.0f));
+		modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), 0.5f);
+		g_sink = modelViewMatrixStack.Top()[3][0];
+		modelViewMatrixStack.Pop();
+	}
+}
+
+static void BenchCameraComputeNormalMatrix(int numIterations)
+{
+	CCamera camera;
+	glm::mat4 modelViewMatrix = glm::lookAt(glm::vec3(0, 10, 100), glm::vec3(100, 0, 0), glm::vec3(0, 1, 0));
+	for (int i = 0; i < numIterations; i++) {
+		modelViewMatrix[3][0] = (float) (i & 255);
+		glm::mat3 normalMatrix = camera.ComputeNormalMatrix(modelViewMatrix);
+		g_sink = normalMatrix[0][0];
+	}
+}
+
+static void BenchShaderProgramSetUniformMat4(int numIterations)
+{
+	glm::mat4 modelViewMatrix(1.0f);
+	for (int i = 0; i < numIterations; i++)
+		g_program.SetUniform("matrices.modelViewMatrix", modelViewMatrix);
+}
+
+static void BenchShaderProgramSetUniformVec3(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++)
+		g_program.SetUniform("light1.La", glm::vec3(0.5f));
+}
+
+static void BenchShaderProgramSetUniformFloat(int numIterations)
+{
+	for (int i = 0; i < numIterations; i++)
+		g_program.SetUniform("material1.shininess", 15.0f);
+}
+
+// The same uploads through handles looked up once, as Game::Render does for every object
+static void BenchShaderProgramSetUniformHandleMat4(int numIterations)
+{
+	UniformHandle<glm::mat4> uniform = g_program.GetUniform<glm::mat4>("matrices.modelViewMatrix");
+	glm::mat4 modelViewMatrix(1.0f);
+	for (int i = 0; i < numIterations; i++)
+		g_program.SetUniform(uniform, modelViewMatrix);
+}
+
+static void BenchShaderProgramSetUniformHandleVec3(int numIterations)
+{
+	UniformHandle<glm::vec3> uniform = g_program.GetUniform<glm::vec3>("light1.La");
+	for (int i = 0; i < numIterations; i++)
+		g_program.SetUniform(uniform, glm::vec3(0.5f));
+}
+
+CBenchmark::CBenchmark()
+{
+	Add("CatmullRom::Sample", BenchCatmullRomSample);
+	Add("CatmullRom::Sample(cursor)", BenchCatmullRomSampleCursor);
+	Add("CatmullRom::Sample(derivatives)", BenchCatmullRomSampleDerivatives);
+	Add("CatmullRom::SampleFrame", BenchCatmullRomSampleFrame);
+	Add("CatmullRom::Project", BenchCatmullRomProject);
+	Add("CatmullRom::Project(warm start)", BenchCatmullRomProjectWarm);
+	Add("CatmullRom::Sample x1024", BenchCatmullRomSample1024);
+	Add("CatmullRom::SampleBatch(1024)", BenchCatmullRomSampleBatch1024);
+	Add("CatmullRom::SampleBatch(1024, scalar)", BenchCatmullRomSampleBatchKernel1024<SampleBatchScalar>);
+	if (GetInstructionSet() >= INSTRUCTION_SET_SSE)
+		Add("CatmullRom::SampleBatch(1024, sse)", BenchCatmullRomSampleBatchKernel1024<SampleBatchSse>);
+	if (GetInstructionSet() >= INSTRUCTION_SET_AVX)
+		Add("CatmullRom::SampleBatch(1024, avx)", BenchCatmullRomSampleBatchKernel1024<SampleBatchAvx>);
+	Add("CatmullRom::Interpolate", BenchCatmullRomInterpolate);
+	Add("CatmullRom::UniformlySampleControlPoints(500)", BenchCatmullRomUniformlySample);
+	Add("CatmullRom::ComputeCentreline(arc length)", BenchCatmullRomComputeArcLengthCentreline);
+	Add("CatmullRom::ComputeOffsetCurves", BenchCatmullRomComputeOffsetCurves);
+	Add("CatmullRom::ComputeTrackMesh", BenchCatmullRomComputeTrackMesh);
+	Add("CatmullRom::ComputeTrackRings(chunk)", BenchCatmullRomComputeTrackRings);
+	Add("PickupPlacer::Place(10000)", BenchPickupPlacerPlace10000);
+	Add("EntityStore::Create/Destroy", BenchEntityStoreCreateDestroy);
+	Add("EntityStore scan(100k)", BenchEntityStoreScan100k);
+	Add("TrackBroadphase::Query(100k)", BenchTrackBroadphaseQuery100k);
+	Add("JobSystem::Run/Wait", BenchJobSystemRunWait);
+	Add("RenderQueue::Submit/Sort(10000)", BenchRenderQueueSubmitSort10000);
+	Add("Frustum::IsVisible", BenchFrustumIsVisible);
+	Add("Frustum::Cull(4096)", BenchFrustumCull4096);
+	Add("Frustum::Cull(4096, scalar)", BenchFrustumCullKernel4096<CullSpheresScalar>);
+	if (GetInstructionSet() >= INSTRUCTION_SET_SSE)
+		Add("Frustum::Cull(4096, sse)", BenchFrustumCullKernel4096<CullSpheresSse>);
+	if (GetInstructionSet() >= INSTRUCTION_SET_AVX)
+		Add("Frustum::Cull(4096, avx)", BenchFrustumCullKernel4096<CullSpheresAvx>);
+	Add("MatrixStack::Push/Translate/Rotate/Pop", BenchMatrixStackPushTranslateRotatePop);
+	Add("Camera::ComputeNormalMatrix", BenchCameraComputeNormalMatrix);
+	Add("ShaderProgram::SetUniform(mat4)", BenchShaderProgramSetUniformMat4);
+	Add("ShaderProgram::SetUniform(vec3)", BenchShaderProgramSetUniformVec3);
+	Add("ShaderProgram::SetUniform(float)", BenchShaderProgramSetUniformFloat);
+	Add("ShaderProgram::SetUniform(handle, mat4)", BenchShaderProgramSetUniformHandleMat4);
+	Add("ShaderProgram::SetUniform(handle, vec3)", BenchShaderProgramSetUniformHandleVec3);
+
+	// The scaling benchmarks change the number of workers, so they run last, and only up to the number of cores
+	int numCores = max((int)thread::hardware_concurrency(), 1);
+	Add("JobSystem::ParallelFor(65536, 1 thread)", BenchJobSystemParallelFor<1>);
+	if (numCores >= 2)
+		Add("JobSystem::ParallelFor(65536, 2 threads)", BenchJobSystemParallelFor<2>);
+	if (numCores >= 4)
+		Add("JobSystem::ParallelFor(65536, 4 threads)", BenchJobSystemParallelFor<4>);
+	if (numCores >= 8)
+		Add("JobSystem::ParallelFor(65536, 8 threads)", BenchJobSystemParallelFor<8>);
+	if (numCores >= 16)
+		Add("JobSystem::ParallelFor(65536, 16 threads)", BenchJobSystemParallelFor<16>);
+}
+
+CBenchmark::~CBenchmark()
+{}
+
+// Register a benchmark.  Names are used as keys in the results files, so they must not contain commas.
+void CBenchmark::Add(string name, BenchmarkFunction function)
+{
+	m_names.push_back(name);
+	m_functions.push_back(function);
+}
+
+// Time one benchmark:  double the iteration count until a run lasts at least MIN_RUN_TIME, then keep the fastest of NUM_RUNS
+CBenchmark::Result CBenchmark::Measure(string name, BenchmarkFunction function)
+{
+	CHighResolutionTimer timer;
+
+	function(1);
+
+	int numIterations = 1;
+	for (;;) {
+		timer.Start();
+		function(numIterations);
+		if (timer.Elapsed() >= MIN_RUN_TIME || numIterations >= (1 << 28))
+			break;
+		numIterations *= 2;
+	}
+
+	double bestTime = 1e30;
+	long long numAllocations = 0;
+	g_countAllocations.store(true);
+	for (int run = 0; run < NUM_RUNS; run++) {
+		long long allocationsBefore = g_allocationCount.load();
+		timer.Start();
+		function(numIterations);
+		double elapsed = timer.Elapsed();
+		numAllocations = g_allocationCount.load() - allocationsBefore;
+		bestTime = min(bestTime, elapsed);
+	}
+	g_countAllocations.store(false);
+
+	Result result;
+	result.name = name;
+	result.nsPerOp = bestTime * 1e6 / numIterations;
+	result.allocsPerOp = (double) numAllocations / numIterations;
+	return result;
+}
+
+// Read results saved by SaveResults
+bool CBenchmark::LoadResults(string filename, vector<Result>& results)
+{
+	ifstream file(filename.c_str());
+	if (!file)
+		return false;
+
+	string line;
+	getline(file, line); // Header
+	while (getline(file, line)) {
+		stringstream ss(line);
+		string nsPerOp, allocsPerOp;
+		Result result;
+		if (getline(ss, result.name, ',') && getline(ss, nsPerOp, ',') && getline(ss, allocsPerOp)) {
+			result.nsPerOp = atof(nsPerOp.c_str());
+			result.allocsPerOp = atof(allocsPerOp.c_str());
+			results.push_back(result);
+		}
+	}
+	return true;
+}
+
+bool CBenchmark::SaveResults(string filename, const vector<Result>& results)
+{
+	FILE* fp;
+	fopen_s(&fp, filename.c_str(), "wt");
+	if (!fp)
+		return false;
+
+	fprintf(fp, "name,ns_per_op,allocs_per_op\n");
+	for (unsigned int i = 0; i < results.size(); i++)
+		fprintf(fp, "%s,%.3f,%.3f\n", results[i].name.c_str(), results[i].nsPerOp, results[i].allocsPerOp);
+	fclose(fp);
+	return true;
+}
+
+// Run the benchmarks and optionally save / compare the results.  Returns 0 on success, 1 on error and 2 on a regression.
+int CBenchmark::Run(const vector<string>& args)
+{
+	string outFilename, baselineFilename, filter;
+	double threshold = 10.0;
+	for (unsigned int i = 0; i + 1 < args.size(); i++) {
+		if (args[i] == "-out")
+			outFilename = args[++i];
+		else if (args[i] == "-baseline")
+			baselineFilename = args[++i];
+		else if (args[i] == "-threshold")
+			threshold = atof(args[++i].c_str());
+		else if (args[i] == "-filter")
+			filter = args[++i];
+	}
+
+	InstallStubGL();
+	SetUpFixtures();
+	printf("instruction set: %s\n", InstructionSetName(GetInstructionSet()));
+	if (!CheckSampleBatchKernels() || !CheckCullSpheresKernels() || !CheckProjectWarmStart())
+		return 1;
+
+	vector<Result> results;
+	for (unsigned int i = 0; i < m_functions.size(); i++) {
+		if (!filter.empty() && m_names[i].find(filter) == string::npos)
+			continue;
+		Result result = Measure(m_names[i], m_functions[i]);
+		printf("%-48s %12.2f ns/op %10.2f allocs/op\n", result.name.c_str(), result.nsPerOp, result.allocsPerOp);
+		results.push_back(result);
+	}
+
+	if (!outFilename.empty() && !SaveResults(outFilename, results)) {
+		fprintf(stderr, "Cannot write benchmark results to %s\n", outFilename.c_str());
+		return 1;
+	}
+
+	if (baselineFilename.empty())
+		return 0;
+
+	vector<Result> baseline;
+	if (!LoadResults(baselineFilename, baseline)) {
+		fprintf(stderr, "Cannot read benchmark baseline %s\n", baselineFilename.c_str());
+		return 1;
+	}
+
+	int numRegressions = 0;
+	for (unsigned int i = 0; i < results.size(); i++) {
+		for (unsigned int j = 0; j < baseline.size(); j++) {
+			if (baseline[j].name != results[i].name)
+				continue;
+			double change = 100.0 * (results[i].nsPerOp - baseline[j].nsPerOp) / baseline[j].nsPerOp;
+			bool slower = change > threshold;
+			bool moreAllocations = results[i].allocsPerOp > baseline[j].allocsPerOp + 0.01;
+			if (slower || moreAllocations) {
+				printf("REGRESSION %s: %.2f -> %.2f ns/op (%+.1f%%), %.2f -> %.2f allocs/op\n", results[i].name.c_str(),
+					baseline[j].nsPerOp, results[i].nsPerOp, change, baseline[j].allocsPerOp, results[i].allocsPerOp);
+				numRegressions++;
+			}
+		}
+	}
+
+	printf("%d regression(s) against %s (threshold %.1f%%)\n", numRegressions, baselineFilename.c_str(), threshold);
+	return numRegressions > 0 ? 2 : 0;
+}
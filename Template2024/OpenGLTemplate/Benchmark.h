@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Common.h"
+
+// Microbenchmarks for the engine's hot paths.  Each benchmark performs its operation a given number of times; the
+// harness grows the count until a run is long enough to time and reports the best of several runs, in nanoseconds
+// and heap allocations per operation.  OpenGL calls go to the stub loader (StubGL.h), so no context or GPU is needed.
+//
+// Results can be saved to a CSV file and compared against a baseline saved earlier.  Run returns non-zero when a
+// benchmark is slower than the baseline by more than the threshold, or allocates more per operation, so it can gate CI.
+class CBenchmark
+{
+public:
+	typedef void (*BenchmarkFunction)(int numIterations);
+
+	CBenchmark();
+	~CBenchmark();
+
+	void Add(string name, BenchmarkFunction function);
+
+	// Arguments:  -out <file.csv>  -baseline <file.csv>  -threshold <percent>  -filter <substring>
+	int Run(const vector<string>& args);
+
+private:
+	struct Result
+	{
+		string name;
+		double nsPerOp;
+		double allocsPerOp;
+	};
+
+	Result Measure(string name, BenchmarkFunction function);
+	bool LoadResults(string filename, vector<Result>& results);
+	bool SaveResults(string filename, const vector<Result>& results);
+
+	vector<string> m_names;
+	vector<BenchmarkFunction> m_functions;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common.h"
+#include <float.h>
+
+// Bounding volumes, worked out once when a mesh is created, in the mesh's own coordinates.  The box is built first;
+// the sphere is then centred on the box and grown over the same points, which is tighter than the box's own sphere.
+
+// Axis-aligned box.  It starts empty, with minimum above maximum, and grows to take in each point.
+struct BoundingBox
+{
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+
+	BoundingBox() : minimum(FLT_MAX), maximum(-FLT_MAX) {}
+
+	void Include(const glm::vec3& p)
+	{
+		minimum = glm::min(minimum, p);
+		maximum = glm::max(maximum, p);
+	}
+	bool IsEmpty() const { return minimum.x > maximum.x; }
+	glm::vec3 Centre() const { return IsEmpty() ? glm::vec3(0.0f) : 0.5f * (minimum + maximum); }
+};
+
+struct BoundingSphere
+{
+	glm::vec3 centre;
+	float radius;
+
+	BoundingSphere() : centre(0.0f), radius(0.0f) {}
+	BoundingSphere(const glm::vec3& centre, float radius) : centre(centre), radius(radius) {}
+
+	void Include(const glm::vec3& p) { radius = max(radius, glm::length(p - centre)); }
+};
+
+// Box and sphere around n points
+inline void ComputeBounds(const glm::vec3* points, size_t n, BoundingBox& box, BoundingSphere& sphere)
+{
+	box = BoundingBox();
+	for (size_t i = 0; i < n; i++)
+		box.Include(points[i]);
+	sphere = BoundingSphere(box.Centre(), 0.0f);
+	for (size_t i = 0; i < n; i++)
+		sphere.Include(points[i]);
+}
+
+// The sphere after transforming by m, which may scale unevenly:  the radius grows by the longest axis
+inline BoundingSphere TransformSphere(const BoundingSphere& sphere, const glm::mat4& m)
+{
+	float scale = max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])), max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])),
+		glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))));
+	return BoundingSphere(glm::vec3(m * glm::vec4(sphere.centre, 1.0f)), sphere.radius * sqrtf(scale));
+}
+
+// The smallest sphere holding both
+inline BoundingSphere MergeSpheres(const BoundingSphere& a, const BoundingSphere& b)
+{
+	glm::vec3 offset = b.centre - a.centre;
+	float distance = glm::length(offset);
+	if (distance + b.radius <= a.radius)
+		return a;
+	if (distance + a.radius <= b.radius)
+		return b;
+	float radius = 0.5f * (distance + a.radius + b.radius);
+	return BoundingSphere(a.centre + offset * ((radius - a.radius) / distance), radius);
+}
+
+// A sphere that holds the object however it is turned about its own y axis, for instances that spin
+inline BoundingSphere SpinningSphere(const BoundingSphere& sphere)
+{
+	float offset = glm::length(glm::vec2(sphere.centre.x, sphere.centre.z));
+	return BoundingSphere(glm::vec3(0.0f, sphere.centre.y, 0.0f), sphere.radius + offset);
+}
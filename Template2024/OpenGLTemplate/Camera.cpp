@@ -185,3 +185,20 @@ glm::mat3 CCamera::ComputeNormalMatrix(const glm::mat4 &modelViewMatrix)
 	return glm::transpose(glm::inverse(glm::mat3(modelViewMatrix)));
 }
 
+// Extract the planes of the view frustum, in world coordinates, from the rows of the view-projection matrix (Gribb and
+// Hartmann).  A point p is inside plane i when dot(planes[i], vec4(p, 1)) >= 0.  The planes are normalised so that this
+// is the distance to the plane, as sphere tests need.  Order:  left, right, bottom, top, near, far.
+void CCamera::GetFrustumPlanes(glm::vec4 planes[6])
+{
+	glm::mat4 m = m_perspectiveProjectionMatrix * GetViewMatrix();
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; i++)
+		row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	for (int i = 0; i < 3; i++) {
+		planes[2 * i] = row[3] + row[i];
+		planes[2 * i + 1] = row[3] - row[i];
+	}
+	for (int i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
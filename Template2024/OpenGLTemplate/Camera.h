@@ -43,6 +43,9 @@ public:
 
 	glm::mat3 ComputeNormalMatrix(const glm::mat4 &modelViewMatrix);
 
+	// Get the six planes bounding the perspective view, in world coordinates, with normals pointing inwards
+	void GetFrustumPlanes(glm::vec4 planes[6]);
+
 private:
 	glm::vec3 m_position;			// The position of the camera's centre of projection
 	glm::vec3 m_view;				// The camera's viewpoint (point where the camera is looking)
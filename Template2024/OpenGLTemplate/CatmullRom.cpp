@@ -1,8 +1,20 @@
 #include "CatmullRom.h"
+#include "CatmullRomBatch.h"
+#include "VertexBufferObjectIndexed.h"
+#include "TrackFile.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+
+// Texture repeats once per this distance along the track
+static const float TRACK_TEXTURE_LENGTH = 9.0f;
 
 // Constructor
 CCatmullRom::CCatmullRom() {
     angle = 2.0;
+    m_parameterisation = ARC_LENGTH;
+    m_frameSpacing = 0.0f;
+    m_trackIndexCount = 0;
+    m_trackIndexType = GL_UNSIGNED_INT;
 }
 
 // Destructor
@@ -25,7 +37,14 @@ glm::vec3 CCatmullRom::Interpolate(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2,
 
 void CCatmullRom::SetControlPoints()
 {
-	// Set control points (m_controlPoints) here, or load from disk
+	// Use the track loaded from disk, if there is one
+	if (!m_trackPoints.empty()) {
+		m_controlPoints = m_trackPoints;
+		m_controlUpVectors = m_trackUpVectors;
+		return;
+	}
+
+	// Otherwise the built-in track
 	m_controlPoints.push_back(glm::vec3(-350, 0.5, -350));
 	m_controlPoints.push_back(glm::vec3(150, 0.5, -250));
 	m_controlPoints.push_back(glm::vec3(350, 0.5, -10));
@@ -67,8 +86,155 @@ void CCatmullRom::ComputeLengthsAlongControlPoints()
 }
 
 
+// Speed |dP/dt| on segment j, from its cached coefficients
+float CCatmullRom::SegmentSpeed(int j, float t)
+{
+	const glm::vec3* c = &m_segmentCoefficients[4 * j];
+	return glm::length(c[1] + (2.0f * c[2] + 3.0f * c[3] * t) * t);
+}
+
+// Arc length of segment j between parameters t0 and t1, by Gauss-Legendre quadrature of the speed
+float CCatmullRom::SegmentArcLength(int j, float t0, float t1)
+{
+	// dP/dt = b + 2ct + 3dt^2
+	const glm::vec3* c = &m_segmentCoefficients[4 * j];
+	glm::vec3 c2 = 2.0f * c[2];
+	glm::vec3 d3 = 3.0f * c[3];
+
+	float fLength = 0.0f;
+	for (int i = 0; i < GAUSS_LEGENDRE_POINTS; i++) {
+		float t = t0 + (t1 - t0) * GAUSS_LEGENDRE_NODES[i];
+		fLength += GAUSS_LEGENDRE_WEIGHTS[i] * glm::length(c[1] + (c2 + d3 * t) * t);
+	}
+	return fLength * (t1 - t0);
+}
+
+// Determine the exact arc length along the closed spline through the control points.  Each segment is integrated in
+// ARC_LENGTH_SUBDIVISIONS pieces; m_distances gets the cumulative length at each control point, as in
+// ComputeLengthsAlongControlPoints, and m_subdivisionDistances the cumulative length at each piece.
+void CCatmullRom::ComputeArcLengths()
+{
+	int M = (int)m_controlPoints.size();
+
+	float fAccumulatedLength = 0.0f;
+	m_distances.push_back(fAccumulatedLength);
+	m_subdivisionDistances.push_back(fAccumulatedLength);
+	for (int j = 0; j < M; j++) {
+		for (int k = 0; k < ARC_LENGTH_SUBDIVISIONS; k++) {
+			float t0 = (float)k / ARC_LENGTH_SUBDIVISIONS;
+			float t1 = (float)(k + 1) / ARC_LENGTH_SUBDIVISIONS;
+			fAccumulatedLength += SegmentArcLength(j, t0, t1);
+			m_subdivisionDistances.push_back(fAccumulatedLength);
+		}
+		m_distances.push_back(fAccumulatedLength);
+	}
+}
+
+// Invert the arc length on segment j:  return the t at which the length from the start of the segment is fLength.
+// Newton's method is started from a linear guess within the piece containing fLength; a step that leaves the bracket
+// around the root is replaced by bisection, so the iteration cannot diverge.
+float CCatmullRom::ArcLengthToParameter(int j, float fLength)
+{
+	int base = j * ARC_LENGTH_SUBDIVISIONS;
+	float fTarget = m_distances[j] + fLength;
+	vector<float>::iterator first = m_subdivisionDistances.begin() + base + 1;
+	int k = (int)(upper_bound(first, first + ARC_LENGTH_SUBDIVISIONS - 1, fTarget) - first);
+
+	float tStart = (float)k / ARC_LENGTH_SUBDIVISIONS;
+	float tLow = tStart;
+	float tHigh = (float)(k + 1) / ARC_LENGTH_SUBDIVISIONS;
+	float fPieceStart = m_subdivisionDistances[base + k];
+	float fPieceLength = m_subdivisionDistances[base + k + 1] - fPieceStart;
+	float fRemaining = fTarget - fPieceStart;
+	if (fPieceLength <= 0.0f)
+		return tStart;
+
+	float t = tLow + (tHigh - tLow) * fRemaining / fPieceLength;
+	for (int i = 0; i < MAX_NEWTON_ITERATIONS; i++) {
+		float fError = SegmentArcLength(j, tStart, t) - fRemaining;
+		if (fabs(fError) < ARC_LENGTH_TOLERANCE)
+			break;
+		if (fError > 0.0f)
+			tHigh = t;
+		else
+			tLow = t;
+
+		float fSpeed = SegmentSpeed(j, t);
+		float tNext = fSpeed > 0.0f ? t - fError / fSpeed : tLow;
+		if (tNext <= tLow || tNext >= tHigh)
+			tNext = 0.5f * (tLow + tHigh);
+		t = tNext;
+	}
+	return t;
+}
+
+// Find the segment j with m_distances[j] <= fLength < m_distances[j + 1], or -1 if fLength is off the end of the table
+int CCatmullRom::FindSegment(float fLength, int& cursor)
+{
+	return FindSplineSegment(&m_distances[0], (int)m_distances.size() - 1, fLength, cursor);
+}
+
 // Return the point (and upvector, if control upvectors provided) based on a distance d along the control polygon
 bool CCatmullRom::Sample(float d, glm::vec3& p, glm::vec3& up)
+{
+	int cursor = -1;
+	return Sample(d, cursor, p, up);
+}
+
+// As above, starting the segment search from cursor.  Keep one cursor per follower, initialised to -1, so that a vehicle
+// moving along the track finds its segment in amortised constant time.
+bool CCatmullRom::Sample(float d, int& cursor, glm::vec3& p, glm::vec3& up)
+{
+	int j;
+	float t;
+	if (!Locate(d, cursor, j, t))
+		return false;
+
+	// Evaluate the cached cubic to get the point
+	const glm::vec3* c = &m_segmentCoefficients[4 * j];
+	p = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+	if (m_controlUpVectors.size() == m_controlPoints.size())
+		up = InterpolateUpVector(j, t);
+
+	return true;
+}
+
+// Sample the point, its derivatives and the curvature at distance d, in one call.  The tangent is exact, so there is no
+// need to sample a second point a little further along.
+bool CCatmullRom::Sample(float d, int& cursor, CurveSample& sample)
+{
+	int j;
+	float t;
+	if (!Locate(d, cursor, j, t))
+		return false;
+
+	// P(t) = a + bt + ct^2 + dt^3, P'(t) = b + 2ct + 3dt^2, P''(t) = 2c + 6dt
+	const glm::vec3* c = &m_segmentCoefficients[4 * j];
+	sample.position = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+	sample.derivative = c[1] + (2.0f * c[2] + 3.0f * c[3] * t) * t;
+	sample.secondDerivative = 2.0f * c[2] + 6.0f * t * c[3];
+
+	// Curvature |P' x P''| / |P'|^3 does not depend on the parameterisation
+	float speed = glm::length(sample.derivative);
+	if (speed > 0.0f) {
+		sample.tangent = sample.derivative / speed;
+		sample.curvature = glm::length(glm::cross(sample.derivative, sample.secondDerivative)) / (speed * speed * speed);
+	}
+	else {
+		sample.tangent = glm::vec3(0.0f);
+		sample.curvature = 0.0f;
+	}
+
+	if (m_controlUpVectors.size() == m_controlPoints.size())
+		sample.up = InterpolateUpVector(j, t);
+	else
+		sample.up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	return true;
+}
+
+// Find the segment j and the parameter t on it at distance d along the track
+bool CCatmullRom::Locate(float d, int& cursor, int& j, float& t)
 {
 	if (d < 0)
 		return false;
@@ -84,35 +250,28 @@ bool CCatmullRom::Sample(float d, glm::vec3& p, glm::vec3& up)
 	float fLength = d - (int)(d / fTotalLength) * fTotalLength;
 
 	// Find the current segment
-	int j = -1;
-	for (int i = 0; i < (int)m_distances.size() - 1; i++) {
-		if (fLength >= m_distances[i] && fLength < m_distances[i + 1]) {
-			j = i; // found it!
-			break;
-		}
-	}
-
+	j = FindSegment(fLength, cursor);
 	if (j == -1)
 		return false;
 
 	// Interpolate on current segment -- get t
-	float fSegmentLength = m_distances[j + 1] - m_distances[j];
-	float t = (fLength - m_distances[j]) / fSegmentLength;
-
-	// Get the indices of the four points along the control polygon for the current segment
-	int iPrev = ((j - 1) + M) % M;
-	int iCur = j;
-	int iNext = (j + 1) % M;
-	int iNextNext = (j + 2) % M;
-
-	// Interpolate to get the point (and upvector)
-	p = Interpolate(m_controlPoints[iPrev], m_controlPoints[iCur], m_controlPoints[iNext], m_controlPoints[iNextNext], t);
-	if (m_controlUpVectors.size() == m_controlPoints.size())
-		up = glm::normalize(Interpolate(m_controlUpVectors[iPrev], m_controlUpVectors[iCur], m_controlUpVectors[iNext], m_controlUpVectors[iNextNext], t));
-
+	if (m_parameterisation == ARC_LENGTH)
+		t = ArcLengthToParameter(j, fLength - m_distances[j]);
+	else {
+		float fSegmentLength = m_distances[j + 1] - m_distances[j];
+		t = (fLength - m_distances[j]) / fSegmentLength;
+	}
 	return true;
 }
 
+// Interpolate the control upvectors on segment j
+glm::vec3 CCatmullRom::InterpolateUpVector(int j, float t)
+{
+	int M = (int)m_controlUpVectors.size();
+	return glm::normalize(Interpolate(m_controlUpVectors[(j - 1 + M) % M], m_controlUpVectors[j], m_controlUpVectors[(j + 1) % M],
+		m_controlUpVectors[(j + 2) % M], t));
+}
+
 
 
 // Sample a set of control points using an open Catmull-Rom spline, to produce a set of iNumSamples that are (roughly) equally spaced
@@ -122,14 +281,16 @@ void CCatmullRom::UniformlySampleControlPoints(int numSamples)
 
 	// Compute the lengths of each segment along the control polygon, and the total length
 	ComputeLengthsAlongControlPoints();
+	ComputeSegmentCoefficients();
 	float fTotalLength = m_distances[m_distances.size() - 1];
 
 	// The spacing will be based on the control polygon
 	float fSpacing = fTotalLength / numSamples;
 
 	// Call PointAt to sample the spline, to generate the points
+	int cursor = -1;
 	for (int i = 0; i < numSamples; i++) {
-		Sample(i * fSpacing, p, up);
+		Sample(i * fSpacing, cursor, p, up);
 		m_centrelinePoints.push_back(p);
 		if (m_controlUpVectors.size() > 0)
 			m_centrelineUpVectors.push_back(up);
@@ -144,10 +305,12 @@ void CCatmullRom::UniformlySampleControlPoints(int numSamples)
 	m_centrelineUpVectors.clear();
 	m_distances.clear();
 	ComputeLengthsAlongControlPoints();
+	ComputeSegmentCoefficients();
 	fTotalLength = m_distances[m_distances.size() - 1];
 	fSpacing = fTotalLength / numSamples;
+	cursor = -1;
 	for (int i = 0; i < numSamples; i++) {
-		Sample(i * fSpacing, p, up);
+		Sample(i * fSpacing, cursor, p, up);
 		m_centrelinePoints.push_back(p);
 		if (m_controlUpVectors.size() > 0)
 			m_centrelineUpVectors.push_back(up);
@@ -158,12 +321,301 @@ void CCatmullRom::UniformlySampleControlPoints(int numSamples)
 
 
 
-void CCatmullRom::CreateCentreline()
+// Store the polynomial coefficients of each segment of the closed curve, P(t) = a + bt + ct^2 + dt^3, so that samples
+// need not rebuild them from the four control points each time
+void CCatmullRom::ComputeSegmentCoefficients()
 {
+	int M = (int)m_controlPoints.size();
+	m_segmentCoefficients.resize(4 * M);
+	for (int j = 0; j < M; j++) {
+		glm::vec3& p0 = m_controlPoints[(j - 1 + M) % M];
+		glm::vec3& p1 = m_controlPoints[j];
+		glm::vec3& p2 = m_controlPoints[(j + 1) % M];
+		glm::vec3& p3 = m_controlPoints[(j + 2) % M];
+		m_segmentCoefficients[4 * j] = p1;
+		m_segmentCoefficients[4 * j + 1] = 0.5f * (-p0 + p2);
+		m_segmentCoefficients[4 * j + 2] = 0.5f * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3);
+		m_segmentCoefficients[4 * j + 3] = 0.5f * (-p0 + 3.0f * p1 - 3.0f * p2 + p3);
+	}
+}
+
+// Evaluate n samples at once.  Positions, and unit tangents if tx, ty and tz are given, are written to separate x / y / z
+// arrays.  Unlike Sample, distances outside the first lap (including negative ones) are wrapped onto the track.
+// Sorted distances are fastest, as the segment search continues from the previous sample.
+void CCatmullRom::SampleBatch(const float* distances, size_t n, float* x, float* y, float* z, float* tx, float* ty, float* tz)
+{
+	// Widest kernel supported by this CPU, chosen on first use.  Batches are sampled from job system workers and the
+	// simulation thread at once, and initialising a local static is thread-safe where a lazily written global is not.
+	static const SampleBatchKernel kernel = SelectSampleBatchKernel();
+
+	SampleBatch(kernel, distances, n, x, y, z, tx, ty, tz);
+}
+
+void CCatmullRom::SampleBatch(SampleBatchKernel kernel, const float* distances, size_t n, float* x, float* y, float* z,
+	float* tx, float* ty, float* tz)
+{
+	if (n == 0 || m_segmentCoefficients.empty())
+		return;
+
+	SplineBatchData spline;
+	spline.distances = &m_distances[0];
+	spline.subdivisionDistances = m_parameterisation == ARC_LENGTH ? &m_subdivisionDistances[0] : NULL;
+	spline.subdivisions = ARC_LENGTH_SUBDIVISIONS;
+	spline.coefficients = &m_segmentCoefficients[0].x;
+	spline.numSegments = (int)m_distances.size() - 1;
+
+	SplineBatchOutput output = { x, y, z, tx, ty, tz };
+	kernel(spline, distances, n, output);
+}
+
+// Sample numSamples points at equal arc length along the spline through the control points, which are left unchanged
+void CCatmullRom::ArcLengthSampleControlPoints(int numSamples)
+{
+	glm::vec3 p, up;
+
+	ComputeSegmentCoefficients();
+	if (!m_trackDistances.empty()) {
+		m_distances = m_trackDistances;
+		m_subdivisionDistances = m_trackSubdivisionDistances;
+	}
+	else
+		ComputeArcLengths();
+	float fSpacing = m_distances.back() / numSamples;
+
+	// Up vectors are only interpolated by Sample; without them the points can be evaluated as a batch
+	if (m_controlUpVectors.empty()) {
+		vector<float> distances(numSamples), x(numSamples), y(numSamples), z(numSamples);
+		for (int i = 0; i < numSamples; i++)
+			distances[i] = i * fSpacing;
+		SampleBatch(&distances[0], numSamples, &x[0], &y[0], &z[0]);
+		for (int i = 0; i < numSamples; i++)
+			m_centrelinePoints.push_back(glm::vec3(x[i], y[i], z[i]));
+		return;
+	}
+
+	int cursor = -1;
+	for (int i = 0; i < numSamples; i++) {
+		Sample(i * fSpacing, cursor, p, up);
+		m_centrelinePoints.push_back(p);
+		m_centrelineUpVectors.push_back(up);
+	}
+}
+
+// Load the control points (and upvectors) from a track file; ComputeCentreline uses them from then on.  An arc length
+// table in the file is used when it was built with the same number of subdivisions, and is otherwise recomputed.
+bool CCatmullRom::LoadTrack(string filename)
+{
+	CTrackFile file;
+	if (!file.Load(filename))
+		return false;
+
+	m_trackPoints.swap(file.m_controlPoints);
+	m_trackUpVectors.swap(file.m_upVectors);
+	m_trackDistances.clear();
+	m_trackSubdivisionDistances.clear();
+	if (file.m_arcLengthSubdivisions == ARC_LENGTH_SUBDIVISIONS) {
+		m_trackDistances.swap(file.m_distances);
+		m_trackSubdivisionDistances.swap(file.m_subdivisionDistances);
+	}
+	return true;
+}
+
+// Save the control points of the last ComputeCentreline in binary form, with its arc length table if wanted.  Only
+// ARC_LENGTH parameterisation keeps the original control points, so with CHORD_LENGTH there is nothing to save.
+bool CCatmullRom::SaveTrack(string filename, bool includeArcLengths)
+{
+	if (m_controlPoints.empty() || m_parameterisation != ARC_LENGTH)
+		return false;
+
+	CTrackFile file;
+	file.m_controlPoints = m_controlPoints;
+	file.m_upVectors = m_controlUpVectors;
+	if (includeArcLengths) {
+		file.m_distances = m_distances;
+		file.m_subdivisionDistances = m_subdivisionDistances;
+		file.m_arcLengthSubdivisions = ARC_LENGTH_SUBDIVISIONS;
+	}
+	return file.Save(filename);
+}
+
+// Choose how distance along the track maps to the spline.  Takes effect at the next ComputeCentreline.
+void CCatmullRom::SetParameterisation(Parameterisation parameterisation)
+{
+	m_parameterisation = parameterisation;
+}
+
+// Compute the centreline on the CPU.  Any previous track is discarded so this can be called again.
+void CCatmullRom::ComputeCentreline()
+{
+	m_controlPoints.clear();
+	m_controlUpVectors.clear();
+	m_centrelinePoints.clear();
+	m_centrelineUpVectors.clear();
+	m_distances.clear();
+	m_subdivisionDistances.clear();
+	m_frames.clear();
+	m_segmentBvh.Clear();
+
 	// Call Set Control Points
 	SetControlPoints();
-	// Call UniformlySampleControlPoints with the number of samples required
-	UniformlySampleControlPoints(500);
+	// Sample the centreline with the number of samples required
+	if (m_parameterisation == ARC_LENGTH)
+		ArcLengthSampleControlPoints(500);
+	else
+		UniformlySampleControlPoints(500);
+
+	ComputeFrameTable();
+	m_segmentBvh.Build(m_segmentCoefficients);
+}
+
+// Distance along the track of parameter t on segment j:  the inverse of ArcLengthToParameter
+float CCatmullRom::ParameterToDistance(int j, float t)
+{
+	if (m_parameterisation == ARC_LENGTH) {
+		int k = min((int)(t * ARC_LENGTH_SUBDIVISIONS), ARC_LENGTH_SUBDIVISIONS - 1);
+		return m_subdivisionDistances[j * ARC_LENGTH_SUBDIVISIONS + k] +
+			SegmentArcLength(j, (float)k / ARC_LENGTH_SUBDIVISIONS, t);
+	}
+	return m_distances[j] + t * (m_distances[j + 1] - m_distances[j]);
+}
+
+// Project q onto the track:  find the closest point on the centreline with the segment hierarchy, then its distance
+// along the track and q's offsets in the frame there.  With warmStart, the segment and t already in projection (from
+// the last query for the same object) seed the search, which makes it much cheaper for objects that move smoothly.
+bool CCatmullRom::Project(const glm::vec3& q, TrackProjection& projection, bool warmStart)
+{
+	int segment;
+	float t, distanceSquared;
+	if (!m_segmentBvh.FindClosest(q, warmStart ? projection.segment : -1, warmStart ? projection.t : 0.0f, segment, t,
+		distanceSquared))
+		return false;
+
+	const glm::vec3* c = &m_segmentCoefficients[4 * segment];
+	projection.point = c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+	projection.distance = ParameterToDistance(segment, t);
+	projection.separation = sqrtf(distanceSquared);
+	projection.segment = segment;
+	projection.t = t;
+
+	CurveFrame frame;
+	SampleFrame(projection.distance, frame);
+	glm::vec3 offset = q - projection.point;
+	projection.lateralOffset = glm::dot(offset, frame.Side());
+	projection.height = glm::dot(offset, frame.Up());
+	return true;
+}
+
+// Build the frame table.  Without control upvectors, the sideways vector is carried from one sample to the next by
+// parallel transport (double reflection, Wang et al. 2008), so the frame never flips or spins about the tangent the
+// way cross(T, world up) does on steep or vertical sections.  On a closed track the transported frame generally comes
+// back twisted relative to where it started; that twist is spread evenly around the lap so the frames join up.  With
+// control upvectors the track is banked, and the frame follows the interpolated upvector instead.
+void CCatmullRom::ComputeFrameTable()
+{
+	m_frames.clear();
+	if (m_distances.empty())
+		return;
+
+	int n = max(FRAME_TABLE_SAMPLES, (int)(m_distances.back() / FRAME_TABLE_SPACING));
+	m_frameSpacing = m_distances.back() / n;
+	bool banked = m_controlUpVectors.size() == m_controlPoints.size();
+
+	vector<glm::vec3> positions(n), tangents(n), ups(n);
+	int cursor = -1;
+	for (int i = 0; i < n; i++) {
+		CurveSample sample;
+		Sample(i * m_frameSpacing, cursor, sample);
+		positions[i] = sample.position;
+		tangents[i] = sample.tangent;
+		ups[i] = sample.up;
+	}
+
+	vector<glm::vec3> sides(n);
+	if (banked) {
+		for (int i = 0; i < n; i++)
+			sides[i] = glm::normalize(glm::cross(tangents[i], ups[i]));
+	}
+	else {
+		// Start from the usual frame against world up, or world x if the track starts vertically
+		glm::vec3 side = glm::cross(tangents[0], glm::vec3(0, 1, 0));
+		if (glm::length(side) < 1e-3f)
+			side = glm::cross(tangents[0], glm::vec3(1, 0, 0));
+		sides[0] = glm::normalize(side);
+
+		// Transport around the whole lap, back to the first sample, to measure the twist
+		glm::vec3 closingSide;
+		for (int i = 1; i <= n; i++) {
+			int k = i % n;
+			glm::vec3 r = sides[i - 1];
+			glm::vec3 t = tangents[i - 1];
+
+			// Reflect in the plane bisecting the two positions, then in the plane that maps the reflected tangent onto the next
+			glm::vec3 v1 = positions[k] - positions[i - 1];
+			float c1 = glm::dot(v1, v1);
+			if (c1 > 1e-12f) {
+				r -= (2.0f / c1) * glm::dot(v1, r) * v1;
+				t -= (2.0f / c1) * glm::dot(v1, t) * v1;
+			}
+			glm::vec3 v2 = tangents[k] - t;
+			float c2 = glm::dot(v2, v2);
+			if (c2 > 1e-12f)
+				r -= (2.0f / c2) * glm::dot(v2, r) * v2;
+
+			r = glm::normalize(r - glm::dot(r, tangents[k]) * tangents[k]);
+			if (i < n)
+				sides[i] = r;
+			else
+				closingSide = r;
+		}
+
+		float twist = atan2f(glm::dot(glm::cross(closingSide, sides[0]), tangents[0]), glm::dot(closingSide, sides[0]));
+		for (int i = 1; i < n; i++)
+			sides[i] = glm::rotate(sides[i], twist * i / n, tangents[i]);
+	}
+
+	m_frames.resize(n);
+	for (int i = 0; i < n; i++) {
+		m_frames[i].position = positions[i];
+		m_frames[i].orientation = glm::mat3(tangents[i], glm::normalize(glm::cross(sides[i], tangents[i])), sides[i]);
+	}
+}
+
+// Look up the frame at distance d.  Positions use cubic Hermite interpolation between the neighbouring table entries,
+// and the orientation is blended and re-orthonormalised, so this costs the same wherever d is.  Like SampleBatch,
+// distances outside the first lap (including negative ones) are wrapped onto the track.
+bool CCatmullRom::SampleFrame(float d, CurveFrame& frame)
+{
+	int n = (int)m_frames.size();
+	if (n == 0)
+		return false;
+
+	float fTotalLength = n * m_frameSpacing;
+	float fLength = d - floorf(d / fTotalLength) * fTotalLength;
+	float u = fLength / m_frameSpacing;
+	int i = (int)u;
+	if (i < 0 || i >= n)
+		i = 0;
+	float s = u - i;
+	const CurveFrame& f0 = m_frames[i];
+	const CurveFrame& f1 = m_frames[(i + 1) % n];
+
+	// Hermite basis; the unit tangents are derivatives with respect to distance, so scale them to the table spacing
+	float s2 = s * s, s3 = s2 * s;
+	float h00 = 2.0f * s3 - 3.0f * s2 + 1.0f, h10 = s3 - 2.0f * s2 + s;
+	float h01 = -2.0f * s3 + 3.0f * s2, h11 = s3 - s2;
+	frame.position = h00 * f0.position + h01 * f1.position + m_frameSpacing * (h10 * f0.Tangent() + h11 * f1.Tangent());
+
+	glm::vec3 T = glm::normalize(glm::mix(f0.Tangent(), f1.Tangent(), s));
+	glm::vec3 N = glm::mix(f0.Side(), f1.Side(), s);
+	N = glm::normalize(N - glm::dot(N, T) * T);
+	frame.orientation = glm::mat3(T, glm::cross(N, T), N);
+	return true;
+}
+
+void CCatmullRom::CreateCentreline()
+{
+	ComputeCentreline();
+
 	// Create a VAO called m_vaoCentreline and a VBO to get the points onto the graphics card
 	 // Generate VAO
 	glGenVertexArrays(1, &m_vaoCentreline);
@@ -193,6 +645,10 @@ void CCatmullRom::CreateCentreline()
 	// Upload VBO data to GPU
 	vboo.UploadDataToGPU(GL_STATIC_DRAW);
 
+	BoundingBox box;
+	if (!m_centrelinePoints.empty())
+		ComputeBounds(&m_centrelinePoints[0], m_centrelinePoints.size(), box, m_centrelineBounds);
+
 	// Set vertex attribute pointers
 	GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
 
@@ -215,125 +671,235 @@ void CCatmullRom::CreateCentreline()
 }
 
 
+// Compute the offset curves, one left, and one right.  Store the points in m_leftOffsetPoints and m_rightOffsetPoints
+// respectively, and their vertices in m_offsetVertices.  Each point needs one frame lookup for both sides, and the
+// points are independent, so they are shared out between jobs that write straight into the sized arrays.
+void CCatmullRom::ComputeOffsetCurves()
+{
+	// Centreline point i lies at distance i * spacing, so the frame table gives its sideways vector
+	int numPoints = (int)m_centrelinePoints.size();
+	float fSpacing = numPoints > 0 ? m_distances.back() / numPoints : 0.0f;
+	m_leftOffsetPoints.resize(numPoints);
+	m_rightOffsetPoints.resize(numPoints);
+	m_offsetVertices.resize(2 * numPoints);
+
+	CJobSystem::GetInstance().ParallelFor(numPoints, 1024, [this, fSpacing, numPoints](int begin, int end) {
+		const float spacing = 15.0f;
+		for (int i = begin; i < end; i++) {
+			float d = i * fSpacing;
+			CurveFrame frame;
+			SampleFrame(d, frame);
+			glm::vec3 N = frame.Side();
+			glm::vec3 p = m_centrelinePoints[i];
+
+			m_leftOffsetPoints[i] = p - spacing * N;
+			m_rightOffsetPoints[i] = p + spacing * N;
+
+			CurveVertex& left = m_offsetVertices[i];
+			CurveVertex& right = m_offsetVertices[numPoints + i];
+			left.position = m_leftOffsetPoints[i];
+			left.texCoord = glm::vec2(0.0f, d / TRACK_TEXTURE_LENGTH);
+			left.normal = frame.Up();
+			right.position = m_rightOffsetPoints[i];
+			right.texCoord = glm::vec2(1.0f, d / TRACK_TEXTURE_LENGTH);
+			right.normal = frame.Up();
+		}
+	});
+}
+
+
+// Put both offset curves in one VBO, and point m_vaoLeftOffsetCurve and m_vaoRightOffsetCurve at their halves of it
 void CCatmullRom::CreateOffsetCurves()
 {
+	ComputeOffsetCurves();
+	if (m_offsetVertices.empty())
+		return;
 
-	glGenVertexArrays(1, &m_vaoLeftOffsetCurve);
-	glBindVertexArray(m_vaoLeftOffsetCurve);
-	// Compute the offset curves, one left, and one right.  Store the points in m_leftOffsetPoints and m_rightOffsetPoints respectively
 	CVertexBufferObject vbo;
 	vbo.Create();
 	vbo.Bind();
+	vbo.AddData(&m_offsetVertices[0], (UINT)(m_offsetVertices.size() * sizeof(CurveVertex)));
+	vbo.UploadDataToGPU(GL_STATIC_DRAW);
 
-	for (int i = 0; i < m_centrelinePoints.size(); i++) {
-		glm::vec3 p = m_centrelinePoints[i];
-		glm::vec3 pNext = m_centrelinePoints[(i + 1) % m_centrelinePoints.size()];
-
-		glm::vec3 T = glm::normalize(pNext - p);
-		glm::vec3 y(0, 1, 0);
-		glm::vec3 N = glm::normalize(glm::cross(T, y));
-		glm::vec3 B = glm::normalize(glm::cross(N, T));
-
-		float spacing = 15.0f;
-
-	
-		glm::vec3 leftPoint = p - (spacing) * N;
-		glm::vec3 rightPoint = p + (spacing) * N;
-
-		// Texture coordinate (set to (0, 0))
-		glm::vec2 texCoord(0.0f, 0.0f);
-
-		// Normal (set to (0, 1, 0))
-		glm::vec3 normal(0.0f, 1.0f, 0.0f);
-
-
-		vbo.AddData(&leftPoint, sizeof(glm::vec3));
-		vbo.AddData(&texCoord, sizeof(glm::vec2));
-		vbo.AddData(&normal, sizeof(glm::vec3));
-		m_leftOffsetPoints.push_back(leftPoint);
+	GLsizei stride = sizeof(CurveVertex);
+	glGenVertexArrays(1, &m_vaoLeftOffsetCurve);
+	glGenVertexArrays(1, &m_vaoRightOffsetCurve);
+	GLuint vaos[2] = { m_vaoLeftOffsetCurve, m_vaoRightOffsetCurve };
+	for (int side = 0; side < 2; side++) {
+		size_t offset = side * m_leftOffsetPoints.size() * sizeof(CurveVertex);
+		glBindVertexArray(vaos[side]);
+		vbo.Bind();
+
+		// Vertex positions
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+		// Texture coordinates
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(CurveVertex, texCoord)));
+		// Normals
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(offset + offsetof(CurveVertex, normal)));
 	}
+	glBindVertexArray(0);
+}
 
-	// Upload VBO data to GPU
-	vbo.UploadDataToGPU(GL_STATIC_DRAW);
 
-	// Set vertex attribute pointers
-	GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
+// Pack a unit normal as signed normalised 10:10:10:2, for a GL_INT_2_10_10_10_REV attribute
+static GLuint PackNormal(glm::vec3 n)
+{
+	n = glm::clamp(n, -1.0f, 1.0f) * 511.0f;
+	GLuint x = (GLuint)(int)floorf(n.x + 0.5f) & 0x3FF;
+	GLuint y = (GLuint)(int)floorf(n.y + 0.5f) & 0x3FF;
+	GLuint z = (GLuint)(int)floorf(n.z + 0.5f) & 0x3FF;
+	return x | (y << 10) | (z << 20);
+}
 
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+// A 30 unit wide road (the same width as the offset curves), with kerbs and low walls on both sides
+vector<TrackProfilePoint> CCatmullRom::DefaultTrackProfile()
+{
+	const float roadHalfWidth = 15.0f, kerbWidth = 2.0f, kerbHeight = 0.3f, wallHeight = 1.5f;
+	const float wall = roadHalfWidth + kerbWidth;
+	TrackProfilePoint points[] = {
+		// Left wall, facing the road
+		{ glm::vec2(-wall, wallHeight), glm::vec2(1, 0), 0.0f, true },
+		{ glm::vec2(-wall, kerbHeight), glm::vec2(1, 0), 0.2f, false },
+		// Left kerb top and edge
+		{ glm::vec2(-wall, kerbHeight), glm::vec2(0, 1), 0.0f, true },
+		{ glm::vec2(-roadHalfWidth, kerbHeight), glm::vec2(0, 1), 0.15f, false },
+		{ glm::vec2(-roadHalfWidth, kerbHeight), glm::vec2(1, 0), 0.15f, true },
+		{ glm::vec2(-roadHalfWidth, 0.0f), glm::vec2(1, 0), 0.17f, false },
+		// Road
+		{ glm::vec2(-roadHalfWidth, 0.0f), glm::vec2(0, 1), 0.0f, true },
+		{ glm::vec2(roadHalfWidth, 0.0f), glm::vec2(0, 1), 2.0f, false },
+		// Right kerb edge and top
+		{ glm::vec2(roadHalfWidth, 0.0f), glm::vec2(-1, 0), 0.17f, true },
+		{ glm::vec2(roadHalfWidth, kerbHeight), glm::vec2(-1, 0), 0.15f, false },
+		{ glm::vec2(roadHalfWidth, kerbHeight), glm::vec2(0, 1), 0.15f, true },
+		{ glm::vec2(wall, kerbHeight), glm::vec2(0, 1), 0.0f, false },
+		// Right wall, facing the road
+		{ glm::vec2(wall, kerbHeight), glm::vec2(-1, 0), 0.2f, true },
+		{ glm::vec2(wall, wallHeight), glm::vec2(-1, 0), 0.0f, false },
+	};
+	return vector<TrackProfilePoint>(points, points + sizeof(points) / sizeof(points[0]));
+}
 
-	// Texture coordinates
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
+// Sweep the profile along the centreline.  Each centreline point gets a ring of vertices placed with the frame table;
+// neighbouring rings share their vertices, so each vertex is stored once and used by up to six triangles.  The last ring
+// repeats the first with the texture coordinate carried on, so the texture does not jump where the lap closes.
+void CCatmullRom::ComputeTrackMesh(const vector<TrackProfilePoint>& profile)
+{
+	m_trackVertices.clear();
+	m_trackIndices.clear();
 
-	// Normals
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+	int numRings = (int)m_centrelinePoints.size() + 1;
+	if (numRings < 2 || profile.size() < 2 || m_frames.empty())
+		return;
 
-	// Unbind VBO and VAO
-	glBindVertexArray(0);
+	ComputeTrackRings(profile, 0.0f, m_distances.back() / (numRings - 1), numRings, m_trackVertices);
+	ComputeTrackIndices(profile, numRings, m_trackIndices);
+}
 
-	glGenVertexArrays(1, &m_vaoRightOffsetCurve);
-	glBindVertexArray(m_vaoRightOffsetCurve);
-	CVertexBufferObject vbo2;
-	vbo2.Create();
-	vbo2.Bind();
-	for (int i = 0; i < m_centrelinePoints.size(); i++) {
-		glm::vec3 p = m_centrelinePoints[i];
-		glm::vec3 pNext = m_centrelinePoints[(i + 1) % m_centrelinePoints.size()];
+// Append numRings rings of profile vertices, starting at distance d0 and spacing apart.  Rings are independent, so a
+// long sweep is shared out between jobs; a streamed chunk is too short to be worth it and stays on this thread.
+void CCatmullRom::ComputeTrackRings(const vector<TrackProfilePoint>& profile, float d0, float spacing, int numRings,
+	vector<TrackVertex>& vertices)
+{
+	int P = (int)profile.size();
+	size_t base = vertices.size();
+	vertices.resize(base + numRings * P);
+	TrackVertex* pRings = &vertices[base];
+
+	CJobSystem::GetInstance().ParallelFor(numRings, 256, [this, &profile, d0, spacing, P, pRings](int begin, int end) {
+		for (int i = begin; i < end; i++) {
+			float d = d0 + i * spacing;
+			CurveFrame frame;
+			SampleFrame(d, frame);
+			glm::vec3 N = frame.Side(), B = frame.Up();
+			TrackVertex* pRing = pRings + i * P;
+			for (int k = 0; k < P; k++) {
+				const TrackProfilePoint& point = profile[k];
+				pRing[k].position = frame.position + point.position.x * N + point.position.y * B;
+				pRing[k].texCoord = glm::vec2(point.u, d / TRACK_TEXTURE_LENGTH);
+				pRing[k].normal = PackNormal(glm::normalize(point.normal.x * N + point.normal.y * B));
+			}
+		}
+	});
+}
 
-		glm::vec3 T = glm::normalize(pNext - p);
-		glm::vec3 y(0, 1, 0);
-		glm::vec3 N = glm::normalize(glm::cross(T, y));
-		glm::vec3 B = glm::normalize(glm::cross(N, T));
+// Two triangles per connected pair of profile points, between each ring and the next, counter-clockwise from the front.
+// The indices depend only on the profile and the number of rings, so equal-sized pieces of track can share them.
+void CCatmullRom::ComputeTrackIndices(const vector<TrackProfilePoint>& profile, int numRings, vector<GLuint>& indices)
+{
+	int P = (int)profile.size();
+	for (int i = 0; i < numRings - 1; i++) {
+		GLuint ring = i * P, nextRing = (i + 1) * P;
+		for (int k = 0; k < P - 1; k++) {
+			if (!profile[k].connected)
+				continue;
+			GLuint triangles[6] = { ring + k, ring + k + 1, nextRing + k,
+				ring + k + 1, nextRing + k + 1, nextRing + k };
+			indices.insert(indices.end(), triangles, triangles + 6);
+		}
+	}
+}
 
-		float spacing = 15.0f;
+// Length of one lap
+float CCatmullRom::Length()
+{
+	return m_distances.empty() ? 0.0f : m_distances.back();
+}
 
+void CCatmullRom::CreateTrack(string textureFilename)
+{
+	CreateTrack(textureFilename, DefaultTrackProfile());
+}
 
-		glm::vec3 leftPoint = p - (spacing)*N;
-		glm::vec3 rightPoint = p + (spacing)*N;
+// Build the track mesh and put it on the graphics card, in one indexed VBO
+void CCatmullRom::CreateTrack(string textureFilename, const vector<TrackProfilePoint>& profile)
+{
+	m_texture.Load(textureFilename);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-		// Texture coordinate (set to (0, 0))
-		glm::vec2 texCoord(0.0f, 0.0f);
+	ComputeTrackMesh(profile);
+	m_trackIndexCount = (unsigned int)m_trackIndices.size();
+	if (m_trackIndexCount == 0)
+		return;
 
-		// Normal (set to (0, 1, 0))
-		glm::vec3 normal(0.0f, 1.0f, 0.0f);
+	glGenVertexArrays(1, &m_vaoTrack);
+	glBindVertexArray(m_vaoTrack);
 
+	CVertexBufferObjectIndexed vbo;
+	vbo.Create();
+	vbo.Bind();
+	vbo.AddVertexData(&m_trackVertices[0], (UINT)(m_trackVertices.size() * sizeof(TrackVertex)));
 
-		vbo2.AddData(&rightPoint, sizeof(glm::vec3));
-		vbo2.AddData(&texCoord, sizeof(glm::vec2));
-		vbo2.AddData(&normal, sizeof(glm::vec3));
-		m_rightOffsetPoints.push_back(rightPoint);
+	// Half the index bandwidth when every vertex can be reached with 16 bits
+	if (m_trackVertices.size() <= 65536) {
+		vector<GLushort> shortIndices(m_trackIndices.begin(), m_trackIndices.end());
+		vbo.AddIndexData(&shortIndices[0], (UINT)(shortIndices.size() * sizeof(GLushort)));
+		m_trackIndexType = GL_UNSIGNED_SHORT;
+	}
+	else {
+		vbo.AddIndexData(&m_trackIndices[0], (UINT)(m_trackIndices.size() * sizeof(GLuint)));
+		m_trackIndexType = GL_UNSIGNED_INT;
 	}
-	vbo2.UploadDataToGPU(GL_STATIC_DRAW);
+	vbo.UploadDataToGPU(GL_STATIC_DRAW);
 
+	GLsizei stride = sizeof(TrackVertex);
+	// Vertex positions
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-
 	// Texture coordinates
 	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-
-	// Normals
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(TrackVertex, texCoord));
+	// Normals, unpacked to [-1, 1] by the GPU
 	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3) + sizeof(glm::vec2)));
+	glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(TrackVertex, normal));
 
-	// Unbind VBO and VAO
 	glBindVertexArray(0);
-
-// Generate VAOs called m_vaoLeftOffsetCurve and m_vaoRightOffsetCurve, each with a VBO, and get the offset curve points on the graphics card
-
-// Note it is possible to only use one VAO / VBO with all the points instead.
-
-}
-
-
-void CCatmullRom::CreateTrack()
-{
-
-	// Generate a VAO called m_vaoTrack and a VBO to get the offset curve points and indices on the graphics card
-
 }
 
 
@@ -353,6 +919,12 @@ void CCatmullRom::RenderCentreline()
 
 }
 
+// The centreline is drawn untextured, as a line loop
+void CCatmullRom::SubmitCentreline(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	queue->Submit(m_vaoCentreline, NULL, GL_LINE_LOOP, 0, (GLsizei)m_centrelinePoints.size(), 0, modelViewMatrix);
+}
+
 void CCatmullRom::RenderOffsetCurves()
 {
 	// Bind the VAO m_vaoLeftOffsetCurve and render it
@@ -383,7 +955,13 @@ void CCatmullRom::RenderOffsetCurves()
 
 void CCatmullRom::RenderTrack()
 {
-	// Bind the VAO m_vaoTrack and render it
+	if (m_trackIndexCount == 0)
+		return;
+
+	glBindVertexArray(m_vaoTrack);
+	m_texture.Bind();
+	glDrawElements(GL_TRIANGLES, m_trackIndexCount, m_trackIndexType, 0);
+	glBindVertexArray(0);
 }
 
 int CCatmullRom::CurrentLap(float d)
@@ -394,120 +972,4 @@ int CCatmullRom::CurrentLap(float d)
 }
 
 glm::vec3 CCatmullRom::_dummy_vector(0.0f, 0.0f, 0.0f);
-
-
-
-
-
-
-
-
-
-
-void CCatmullRom::CreatePath(string filename)
-{
-	m_texture.Load(filename);
-	m_texture.SetSamplerObjectParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	m_texture.SetSamplerObjectParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
-	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	std::vector<glm::vec3> pathVertices;
-
-    // Use VAO to store state associated with vertices
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-    // Create a VBO
-    CVertexBufferObject vbo;
-    vbo.Create();
-    vbo.Bind();
-	glm::vec2 t0 = glm::vec2(0, 0);
-	glm::vec2 t1 = glm::vec2(2, 0);
-	glm::vec2 t2 = glm::vec2(2, 2);
-	glm::vec2 t3 = glm::vec2(0, 2);
-    glm::vec3 normal(0.0f, 3.0f, 0.0f);
-    for (unsigned int i = 0; i < m_rightOffsetPoints.size()-3; i=i+3) {
-       
-        vbo.AddData(&m_leftOffsetPoints[i], sizeof(glm::vec3));
-        vbo.AddData(&t0, sizeof(glm::vec2));
-        vbo.AddData(&normal, sizeof(glm::vec3));
-
-		vbo.AddData(&m_rightOffsetPoints[i], sizeof(glm::vec3));
-		vbo.AddData(&t1, sizeof(glm::vec2));
-		vbo.AddData(&normal, sizeof(glm::vec3));
-
-		pathVertices.push_back(m_leftOffsetPoints[i]);
-		pathVertices.push_back(m_rightOffsetPoints[i]);
-
-		vbo.AddData(&m_leftOffsetPoints[i+3], sizeof(glm::vec3));
-		vbo.AddData(&t2, sizeof(glm::vec2));
-		vbo.AddData(&normal, sizeof(glm::vec3));
-
-		vbo.AddData(&m_rightOffsetPoints[i+3], sizeof(glm::vec3));
-		vbo.AddData(&t3, sizeof(glm::vec2));
-		vbo.AddData(&normal, sizeof(glm::vec3));
-
-		pathVertices.push_back(m_leftOffsetPoints[i+3]);
-		pathVertices.push_back(m_rightOffsetPoints[i+3]);
-
-
-		//maby make new vector to store left and right points
-
-    }
-
-	vbo.AddData(&m_leftOffsetPoints[0], sizeof(glm::vec3));
-	vbo.AddData(&t0, sizeof(glm::vec2));
-	vbo.AddData(&normal, sizeof(glm::vec3));
-
-	vbo.AddData(&m_rightOffsetPoints[0], sizeof(glm::vec3));
-	vbo.AddData(&t1, sizeof(glm::vec2));
-	vbo.AddData(&normal, sizeof(glm::vec3));
-
-
-	m_vertexCount = pathVertices.size();
-
-    // Upload the VBO to the GPU
-    vbo.UploadDataToGPU(GL_STATIC_DRAW);
-    // Set the vertex attribute locations
-    GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
-    // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
-    // Texture coordinates
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)sizeof(glm::vec3));
-    
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3)
-        + sizeof(glm::vec2)));
-
-	glBindVertexArray(0);
-}
-
-
-
-void CCatmullRom::RenderPath() {
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	// Bind the VAO
-    glBindVertexArray(m_vao);
-	m_texture.Bind();
-
-    // Set line width if supported
-    glLineWidth(2.0f); // Adjust as needed
-    // Draw the path using GL_LINE_STRIP primitive with 100 vertices
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, m_vertexCount);
-	//glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	//m_texture.Release();
-    // Unbind the VAO
-    glBindVertexArray(0);
-
-}
-//add release destructuor like in cube.cpp
-
-glm::vec3 CCatmullRom::RandomPos() {
-	
-	int random = rand() % m_leftOffsetPoints.size();
-	float t = static_cast <float> (rand()) / static_cast <float> (RAND_MAX);
-	glm::vec3 randomPoint = m_leftOffsetPoints[random] + t * (m_rightOffsetPoints[random] - m_leftOffsetPoints[random]);
-	return randomPoint;
-}
\ No newline at end of file
+const float CCatmullRom::FRAME_TABLE_SPACING = 2.0f;
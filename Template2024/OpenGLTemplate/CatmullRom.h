@@ -2,42 +2,153 @@
 #include "Common.h"
 #include "VertexBufferObject.h"
 #include "Texture.h"
+#include "SegmentBvh.h"
+#include "Bounds.h"
+#include "CatmullRomBatch.h"
+
+class CRenderQueue;
+
+// Everything about the centreline at one distance along it
+struct CurveSample
+{
+	glm::vec3 position;
+	glm::vec3 tangent;			// Unit tangent, in the direction of travel
+	glm::vec3 up;				// Interpolated control upvector, or world up if there are none
+	glm::vec3 derivative;		// dP/dt
+	glm::vec3 secondDerivative;	// d2P/dt2
+	float curvature;			// 1 / radius of the turn
+};
+
+// Position and orientation at one distance along the centreline.  The orientation columns are the unit tangent T, the
+// up vector B and the sideways vector N = T x B, as used by Game for the vehicles.
+struct CurveFrame
+{
+	glm::vec3 position;
+	glm::mat3 orientation;
+
+	glm::vec3 Tangent() const { return orientation[0]; }
+	glm::vec3 Up() const { return orientation[1]; }
+	glm::vec3 Side() const { return orientation[2]; }
+};
+
+// A point in space projected onto the centreline
+struct TrackProjection
+{
+	glm::vec3 point;		// Closest point on the centreline
+	float distance;			// Distance along the track to that point, within the first lap
+	float lateralOffset;	// Offset from the centreline along the frame's sideways vector (towards the right offset curve)
+	float height;			// Offset from the centreline along the frame's up vector
+	float separation;		// Distance from the point to the centreline
+	int segment;			// Spline segment and parameter of the closest point; also the warm start for the next query
+	float t;
+};
+
+// One point of the track cross-section, in the plane of the frame at each distance:  x is along the sideways vector and
+// y along the up vector, so (0, 0) is the centreline.  A surface runs from each point to the next if connected is set,
+// and faces the left of that direction in (x, y) -- e.g. left to right across the road faces up.  Hard edges such as
+// kerbs are made by repeating a point with a different normal.
+struct TrackProfilePoint
+{
+	glm::vec2 position;
+	glm::vec2 normal;
+	float u;				// Texture coordinate across the profile
+	bool connected;			// Whether the surface continues to the next point
+};
+
+// Vertex of the centreline and offset curves, laid out like the VBOs of the template's other shapes
+struct CurveVertex
+{
+	glm::vec3 position;
+	glm::vec2 texCoord;
+	glm::vec3 normal;
+};
+
+// Compact track vertex (24 bytes):  the normal is packed as GL_INT_2_10_10_10_REV
+struct TrackVertex
+{
+	glm::vec3 position;
+	glm::vec2 texCoord;
+	GLuint normal;
+};
+
 class CCatmullRom
 {
 public:
+	// How a distance along the track is mapped to the spline.  ARC_LENGTH is exact:  segment lengths are integrated with
+	// Gauss-Legendre quadrature and inverted with Newton's method.  CHORD_LENGTH resamples the control points twice
+	// against the chord lengths of the control polygon, which is only approximately uniform and replaces the control points.
+	enum Parameterisation { CHORD_LENGTH, ARC_LENGTH };
+
 	CCatmullRom();
 	~CCatmullRom();
 	glm::vec3 Interpolate(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3,
 		float t);
-	void CreatePath(string filename);
-	void RenderPath();
+	void SetParameterisation(Parameterisation parameterisation);
+	bool LoadTrack(string filename);	// Control points for the next ComputeCentreline, from a .trk or text file
+	bool SaveTrack(string filename, bool includeArcLengths);	// Write the current track as a .trk file
 
+	void ComputeCentreline();		// Sets and resamples the control points -- no OpenGL calls, so usable without a context
 	void CreateCentreline();
 	void RenderCentreline();
+	void SubmitCentreline(CRenderQueue* queue, const glm::mat4& modelViewMatrix);
+	const BoundingSphere& GetCentrelineBounds() const { return m_centrelineBounds; }
 
+	void ComputeOffsetCurves();		// Computes the left and right offset points -- no OpenGL calls
 	void CreateOffsetCurves();
 	void RenderOffsetCurves();
 
-	void CreateTrack();
+	void ComputeTrackMesh(const vector<TrackProfilePoint>& profile);	// Sweeps the profile along the centreline -- no OpenGL calls
+	void ComputeTrackRings(const vector<TrackProfilePoint>& profile, float d0, float spacing, int numRings,
+		vector<TrackVertex>& vertices);									// Part of the sweep, for streaming -- no OpenGL calls
+	static void ComputeTrackIndices(const vector<TrackProfilePoint>& profile, int numRings, vector<GLuint>& indices);
+	void CreateTrack(string textureFilename);							// Road with kerbs and low walls
+	void CreateTrack(string textureFilename, const vector<TrackProfilePoint>& profile);
 	void RenderTrack();
+	static vector<TrackProfilePoint> DefaultTrackProfile();
 
+	float Length();	// Length of one lap
 	int CurrentLap(float d); // Return the currvent lap (starting from 0) based on distance along the control curve.
 
 	bool Sample(float d, glm::vec3& p, glm::vec3& up = _dummy_vector); // Return a point on the centreline based on a certain distance along the control curve.
-
-	glm::vec3 RandomPos();
+	bool Sample(float d, int& cursor, glm::vec3& p, glm::vec3& up = _dummy_vector); // As above, with a per-follower search cursor (start at -1)
+	bool Sample(float d, int& cursor, CurveSample& sample); // Position, exact tangent, derivatives and curvature in one call
+	void SampleBatch(const float* distances, size_t n, float* x, float* y, float* z,
+		float* tx = NULL, float* ty = NULL, float* tz = NULL); // Many samples at once (SIMD), in structure-of-arrays form
+	void SampleBatch(SampleBatchKernel kernel, const float* distances, size_t n, float* x, float* y, float* z,
+		float* tx, float* ty, float* tz); // As above, with the given kernel rather than the widest one, to compare them
+	bool SampleFrame(float d, CurveFrame& frame); // Position and twist-free orientation from the precomputed frame table
+	bool Project(const glm::vec3& q, TrackProjection& projection, bool warmStart = false); // Closest point on the track to q
 
 	float angle;
 private:
-	GLuint m_vao;
-
 	void SetControlPoints();
 	void ComputeLengthsAlongControlPoints();
 	void UniformlySampleControlPoints(int numSamples);
+	void ArcLengthSampleControlPoints(int numSamples);
+	void ComputeArcLengths();
+	float SegmentSpeed(int j, float t);
+	float SegmentArcLength(int j, float t0, float t1);
+	float ArcLengthToParameter(int j, float fLength);
+	float ParameterToDistance(int j, float t);
+	int FindSegment(float fLength, int& cursor);
+	bool Locate(float d, int& cursor, int& j, float& t);
+	glm::vec3 InterpolateUpVector(int j, float t);
+	void ComputeSegmentCoefficients();
+	void ComputeFrameTable();
+
+	static const int ARC_LENGTH_SUBDIVISIONS = 16;	// Quadrature pieces per segment
+	static const int FRAME_TABLE_SAMPLES = 2048;	// Minimum frames per lap in the frame table
+	static const float FRAME_TABLE_SPACING;			// Maximum distance between frames, so long tracks keep their detail
+	Parameterisation m_parameterisation;
 	//glm::vec3 Interpolate(glm::vec3& p0, glm::vec3& p1, glm::vec3& p2, glm::vec3& p3, float t);
 
 
 	vector<float> m_distances;
+	vector<float> m_subdivisionDistances;	// Arc length at each quadrature piece (ARC_LENGTH only)
+	vector<glm::vec3> m_segmentCoefficients;// Polynomial coefficients a, b, c, d of each segment
+	vector<CurveFrame> m_frames;			// Parallel-transported frames at equal distances around the lap
+	float m_frameSpacing;					// Distance between entries of m_frames
+	CSegmentBvh m_segmentBvh;				// Hierarchy over the segments, for Project
 	CTexture m_texture;
 
 	GLuint m_vaoCentreline;
@@ -46,16 +157,25 @@ private:
 	GLuint m_vaoTrack;
 
 	static glm::vec3 _dummy_vector;
+	vector<glm::vec3> m_trackPoints;		// Control points loaded by LoadTrack, used instead of the built-in track
+	vector<glm::vec3> m_trackUpVectors;
+	vector<float> m_trackDistances;			// Arc length table loaded by LoadTrack, if the file has one
+	vector<float> m_trackSubdivisionDistances;
 	vector<glm::vec3> m_controlPoints;		// Control points, which are interpolated to produce the centreline points
 	vector<glm::vec3> m_controlUpVectors;	// Control upvectors, which are interpolated to produce the centreline upvectors
 	vector<glm::vec3> m_centrelinePoints;	// Centreline points
 	vector<glm::vec3> m_centrelineUpVectors;// Centreline upvectors
+	BoundingSphere m_centrelineBounds;
 
 	vector<glm::vec3> m_leftOffsetPoints;	// Left offset curve points
 	vector<glm::vec3> m_rightOffsetPoints;	// Right offset curve points
+	vector<CurveVertex> m_offsetVertices;	// Left offset curve vertices followed by the right, as uploaded to the GPU
 
 
-	unsigned int m_vertexCount;				// Number of vertices in the track VBO
+	vector<TrackVertex> m_trackVertices;	// Track mesh:  one ring of profile vertices per centreline point, plus a closing ring
+	vector<GLuint> m_trackIndices;			// Track triangles
+	unsigned int m_trackIndexCount;			// Number of indices in the track VBO
+	GLenum m_trackIndexType;				// GL_UNSIGNED_SHORT when the vertices can be indexed in 16 bits
 
 
 };
@@ -0,0 +1,112 @@
+#include "CatmullRomBatch.h"
+#include "CpuFeatures.h"
+
+#include <emmintrin.h>
+
+// Scalar fallback:  one sample at a time, with the same steps as the SIMD kernels
+static float ScalarSpeed(const float* c, float t)
+{
+	float x = c[3] + (2.0f * c[6] + 3.0f * c[9] * t) * t;
+	float y = c[4] + (2.0f * c[7] + 3.0f * c[10] * t) * t;
+	float z = c[5] + (2.0f * c[8] + 3.0f * c[11] * t) * t;
+	return sqrtf(x * x + y * y + z * z);
+}
+
+static float ScalarArcLength(const float* c, float t0, float t1)
+{
+	float length = 0.0f;
+	for (int i = 0; i < GAUSS_LEGENDRE_POINTS; i++)
+		length += GAUSS_LEGENDRE_WEIGHTS[i] * ScalarSpeed(c, t0 + (t1 - t0) * GAUSS_LEGENDRE_NODES[i]);
+	return length * (t1 - t0);
+}
+
+void SampleBatchScalar(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output)
+{
+	int cursor = -1;
+	bool tangents = output.tx != NULL && output.ty != NULL && output.tz != NULL;
+
+	for (size_t i = 0; i < n; i++) {
+		SplinePiece piece;
+		LocateSplinePiece(spline, distances[i], cursor, piece);
+		const float* c = spline.coefficients + 12 * piece.segment;
+
+		float tLow = piece.tStart, tHigh = piece.tEnd;
+		float t = piece.tStart;
+		if (piece.pieceLength > 0.0f)
+			t += (piece.tEnd - piece.tStart) * piece.remaining / piece.pieceLength;
+
+		if (spline.subdivisionDistances != NULL) {
+			for (int iteration = 0; iteration < MAX_NEWTON_ITERATIONS; iteration++) {
+				float error = ScalarArcLength(c, piece.tStart, t) - piece.remaining;
+				if (fabsf(error) < ARC_LENGTH_TOLERANCE)
+					break;
+				if (error > 0.0f)
+					tHigh = t;
+				else
+					tLow = t;
+				float speed = ScalarSpeed(c, t);
+				float tNext = speed > 0.0f ? t - error / speed : tLow;
+				if (tNext <= tLow || tNext >= tHigh)
+					tNext = 0.5f * (tLow + tHigh);
+				t = tNext;
+			}
+		}
+
+		output.x[i] = c[0] + t * (c[3] + t * (c[6] + t * c[9]));
+		output.y[i] = c[1] + t * (c[4] + t * (c[7] + t * c[10]));
+		output.z[i] = c[2] + t * (c[5] + t * (c[8] + t * c[11]));
+
+		if (tangents) {
+			float dx = c[3] + (2.0f * c[6] + 3.0f * c[9] * t) * t;
+			float dy = c[4] + (2.0f * c[7] + 3.0f * c[10] * t) * t;
+			float dz = c[5] + (2.0f * c[8] + 3.0f * c[11] * t) * t;
+			float length = sqrtf(dx * dx + dy * dy + dz * dz);
+			float scale = length > 0.0f ? 1.0f / length : 0.0f;
+			output.tx[i] = dx * scale;
+			output.ty[i] = dy * scale;
+			output.tz[i] = dz * scale;
+		}
+	}
+}
+
+// SSE2 operations for SampleBatchSimd.  SSE2 is part of x64; only a 32-bit build checks for it (see GetInstructionSet).
+struct SseOperations
+{
+	typedef __m128 V;
+	enum { WIDTH = 4 };
+
+	static V Set1(float x) { return _mm_set1_ps(x); }
+	static V Load(const float* p) { return _mm_loadu_ps(p); }
+	static void Store(float* p, V x) { _mm_storeu_ps(p, x); }
+	static V Add(V a, V b) { return _mm_add_ps(a, b); }
+	static V Sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static V Div(V a, V b) { return _mm_div_ps(a, b); }
+	static V Sqrt(V a) { return _mm_sqrt_ps(a); }
+	static V Abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static V CmpGt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+	static V CmpGe(V a, V b) { return _mm_cmpge_ps(a, b); }
+	static V CmpLt(V a, V b) { return _mm_cmplt_ps(a, b); }
+	static V And(V a, V b) { return _mm_and_ps(a, b); }
+	static V AndNot(V a, V b) { return _mm_andnot_ps(a, b); }	// ~a & b
+	static V Select(V mask, V a, V b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	static bool AnyTrue(V mask) { return _mm_movemask_ps(mask) != 0; }
+};
+
+void SampleBatchSse(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output)
+{
+	SampleBatchSimd<SseOperations>::Run(spline, distances, n, output);
+}
+
+// Pick the widest kernel the machine supports, or the one -isa limits the game to
+SampleBatchKernel SelectSampleBatchKernel()
+{
+	switch (GetInstructionSet()) {
+	case INSTRUCTION_SET_AVX:
+		return SampleBatchAvx;
+	case INSTRUCTION_SET_SSE:
+		return SampleBatchSse;
+	default:
+		return SampleBatchScalar;
+	}
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <stddef.h>
+#include <math.h>
+
+// Spline evaluation shared by CCatmullRom::Sample and the SampleBatch kernels.  The kernels are compiled once per
+// instruction set (CatmullRomBatch.cpp for scalar and SSE, CatmullRomBatchAvx.cpp with AVX enabled), so they work on
+// plain arrays rather than on the class.
+//
+// The helpers below are static, and use no standard library templates, so every file that includes this header
+// compiles its own copy.  An ordinary inline function would be merged across files by the linker, which could keep the
+// copy built with AVX instructions and so break the scalar and SSE paths on a CPU without AVX.
+
+// Five-point Gauss-Legendre rule on [0, 1]:  exact for polynomials up to degree 9
+static const int GAUSS_LEGENDRE_POINTS = 5;
+static const float GAUSS_LEGENDRE_NODES[GAUSS_LEGENDRE_POINTS] = {
+	0.0469100770f, 0.2307653449f, 0.5f, 0.7692346551f, 0.9530899230f };
+static const float GAUSS_LEGENDRE_WEIGHTS[GAUSS_LEGENDRE_POINTS] = {
+	0.1184634425f, 0.2393143352f, 0.2844444444f, 0.2393143352f, 0.1184634425f };
+
+static const float ARC_LENGTH_TOLERANCE = 1e-3f;	// Newton stops when within this distance of the target arc length
+static const int MAX_NEWTON_ITERATIONS = 8;
+
+// The spline as seen by the kernels
+struct SplineBatchData
+{
+	const float* distances;				// numSegments + 1 cumulative lengths, at the start of each segment
+	const float* subdivisionDistances;	// Cumulative arc length at each quadrature piece, or NULL for chord-length parameterisation
+	int subdivisions;					// Quadrature pieces per segment
+	const float* coefficients;			// 12 per segment:  P(t) = a + bt + ct^2 + dt^3, stored as a.xyz, b.xyz, c.xyz, d.xyz
+	int numSegments;
+};
+
+// Structure-of-arrays output.  The tangent pointers may be NULL if tangents are not wanted.
+struct SplineBatchOutput
+{
+	float* x;
+	float* y;
+	float* z;
+	float* tx;
+	float* ty;
+	float* tz;
+};
+
+typedef void (*SampleBatchKernel)(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output);
+
+void SampleBatchScalar(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output);
+void SampleBatchSse(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output);
+void SampleBatchAvx(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output);
+SampleBatchKernel SelectSampleBatchKernel();
+
+// Index of the first of the count values that is greater than value, or count if there is none, as std::upper_bound
+static inline int FindFirstGreater(const float* values, int count, float value)
+{
+	int low = 0, high = count;
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+		if (values[middle] > value)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+// Find the segment j with distances[j] <= fLength < distances[j + 1], or -1 if fLength is off the end of the table.
+// The search starts from the cursor, which is left on the segment found:  a query close to the previous one is found by
+// stepping a few segments, and anything else by binary search.
+static inline int FindSplineSegment(const float* distances, int numSegments, float fLength, int& cursor)
+{
+	if (fLength < 0.0f || fLength >= distances[numSegments])
+		return -1;
+
+	if (cursor >= 0 && cursor < numSegments) {
+		int j = cursor;
+		if (fLength >= distances[j]) {
+			for (int step = 0; step < 4 && j < numSegments; step++, j++) {
+				if (fLength < distances[j + 1]) {
+					cursor = j;
+					return j;
+				}
+			}
+		}
+		else if (j > 0 && fLength >= distances[j - 1]) {
+			cursor = j - 1;
+			return j - 1;
+		}
+	}
+
+	// Binary search:  the first distance greater than fLength ends the segment
+	cursor = FindFirstGreater(distances, numSegments + 1, fLength) - 1;
+	return cursor;
+}
+
+// Where a sample falls on the spline:  its segment, the parameter range [tStart, tEnd] of the piece containing it, and
+// how far into that piece it is.  In chord-length mode the piece is the whole segment and t is linear in the distance.
+struct SplinePiece
+{
+	int segment;
+	float tStart, tEnd;
+	float remaining;
+	float pieceLength;
+};
+
+// Wrap d onto one lap (negative distances count back from the end) and locate it
+static inline void LocateSplinePiece(const SplineBatchData& spline, float d, int& cursor, SplinePiece& piece)
+{
+	float fTotalLength = spline.distances[spline.numSegments];
+	float fLength = d - floorf(d / fTotalLength) * fTotalLength;
+	if (fLength >= fTotalLength || fLength < 0.0f)
+		fLength = 0.0f;
+
+	int j = FindSplineSegment(spline.distances, spline.numSegments, fLength, cursor);
+	piece.segment = j;
+
+	if (spline.subdivisionDistances == NULL) {
+		piece.tStart = 0.0f;
+		piece.tEnd = 1.0f;
+		piece.remaining = fLength - spline.distances[j];
+		piece.pieceLength = spline.distances[j + 1] - spline.distances[j];
+		return;
+	}
+
+	const float* first = spline.subdivisionDistances + j * spline.subdivisions + 1;
+	int k = FindFirstGreater(first, spline.subdivisions - 1, fLength);
+	piece.tStart = (float)k / spline.subdivisions;
+	piece.tEnd = (float)(k + 1) / spline.subdivisions;
+	piece.remaining = fLength - first[k - 1];
+	piece.pieceLength = first[k] - first[k - 1];
+}
+
+// SIMD kernel, instantiated with an operations struct S for each instruction set.  S provides a vector type V of WIDTH
+// floats, arithmetic, comparisons returning lane masks, Select(mask, a, b) and AnyTrue(mask).
+template <class S>
+struct SampleBatchSimd
+{
+	typedef typename S::V V;
+	enum { WIDTH = S::WIDTH };
+
+	static V Length(V x, V y, V z)
+	{
+		return S::Sqrt(S::Add(S::Add(S::Mul(x, x), S::Mul(y, y)), S::Mul(z, z)));
+	}
+
+	// |dP/dt| where dP/dt = b + 2ct + 3dt^2
+	static V Speed(const V* c, V t)
+	{
+		V two = S::Set1(2.0f), three = S::Set1(3.0f);
+		V x = S::Add(c[3], S::Mul(S::Add(S::Mul(two, c[6]), S::Mul(S::Mul(three, c[9]), t)), t));
+		V y = S::Add(c[4], S::Mul(S::Add(S::Mul(two, c[7]), S::Mul(S::Mul(three, c[10]), t)), t));
+		V z = S::Add(c[5], S::Mul(S::Add(S::Mul(two, c[8]), S::Mul(S::Mul(three, c[11]), t)), t));
+		return Length(x, y, z);
+	}
+
+	static V ArcLength(const V* c, V t0, V t1)
+	{
+		V dt = S::Sub(t1, t0);
+		V length = S::Set1(0.0f);
+		for (int i = 0; i < GAUSS_LEGENDRE_POINTS; i++) {
+			V t = S::Add(t0, S::Mul(dt, S::Set1(GAUSS_LEGENDRE_NODES[i])));
+			length = S::Add(length, S::Mul(S::Set1(GAUSS_LEGENDRE_WEIGHTS[i]), Speed(c, t)));
+		}
+		return S::Mul(length, dt);
+	}
+
+	// Evaluate WIDTH samples.  Locating the samples is scalar; solving for t and evaluating the spline is done across lanes.
+	static void SampleLanes(const SplineBatchData& spline, const float* distances, int& cursor, float* out[6])
+	{
+		float tStart[WIDTH], tEnd[WIDTH], remaining[WIDTH], pieceLength[WIDTH];
+		float coefficients[12][WIDTH];
+		for (int lane = 0; lane < WIDTH; lane++) {
+			SplinePiece piece;
+			LocateSplinePiece(spline, distances[lane], cursor, piece);
+			tStart[lane] = piece.tStart;
+			tEnd[lane] = piece.tEnd;
+			remaining[lane] = piece.remaining;
+			pieceLength[lane] = piece.pieceLength > 0.0f ? piece.pieceLength : 1.0f;
+			const float* segmentCoefficients = spline.coefficients + 12 * piece.segment;
+			for (int i = 0; i < 12; i++)
+				coefficients[i][lane] = segmentCoefficients[i];
+		}
+
+		V c[12];
+		for (int i = 0; i < 12; i++)
+			c[i] = S::Load(coefficients[i]);
+
+		V t0 = S::Load(tStart), tLow = t0, tHigh = S::Load(tEnd);
+		V target = S::Load(remaining);
+		V t = S::Add(t0, S::Div(S::Mul(S::Sub(tHigh, t0), target), S::Load(pieceLength)));
+
+		// Newton's method with a bisection fallback, as in CCatmullRom::ArcLengthToParameter; converged lanes are frozen
+		if (spline.subdivisionDistances != NULL) {
+			V half = S::Set1(0.5f), tolerance = S::Set1(ARC_LENGTH_TOLERANCE);
+			for (int i = 0; i < MAX_NEWTON_ITERATIONS; i++) {
+				V error = S::Sub(ArcLength(c, t0, t), target);
+				V active = S::CmpGe(S::Abs(error), tolerance);
+				if (!S::AnyTrue(active))
+					break;
+				V tooFar = S::CmpGt(error, S::Set1(0.0f));
+				tHigh = S::Select(S::And(active, tooFar), t, tHigh);
+				tLow = S::Select(S::AndNot(tooFar, active), t, tLow);
+
+				V tNext = S::Sub(t, S::Div(error, Speed(c, t)));
+				V inside = S::And(S::CmpGt(tNext, tLow), S::CmpLt(tNext, tHigh));	// Also false for NaN
+				tNext = S::Select(inside, tNext, S::Mul(half, S::Add(tLow, tHigh)));
+				t = S::Select(active, tNext, t);
+			}
+		}
+
+		// P(t) = a + t(b + t(c + td))
+		for (int axis = 0; axis < 3; axis++) {
+			V p = S::Add(c[axis], S::Mul(t, S::Add(c[3 + axis], S::Mul(t, S::Add(c[6 + axis], S::Mul(t, c[9 + axis]))))));
+			S::Store(out[axis], p);
+		}
+
+		if (out[3] != NULL) {
+			V two = S::Set1(2.0f), three = S::Set1(3.0f);
+			V d[3];
+			for (int axis = 0; axis < 3; axis++)
+				d[axis] = S::Add(c[3 + axis], S::Mul(S::Add(S::Mul(two, c[6 + axis]), S::Mul(S::Mul(three, c[9 + axis]), t)), t));
+			V length = Length(d[0], d[1], d[2]);
+			V scale = S::Select(S::CmpGt(length, S::Set1(0.0f)), S::Div(S::Set1(1.0f), length), S::Set1(0.0f));
+			for (int axis = 0; axis < 3; axis++)
+				S::Store(out[3 + axis], S::Mul(d[axis], scale));
+		}
+	}
+
+	static void Run(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output)
+	{
+		int cursor = -1;
+		bool tangents = output.tx != NULL && output.ty != NULL && output.tz != NULL;
+
+		size_t i = 0;
+		for (; i + WIDTH <= n; i += WIDTH) {
+			float* out[6] = { output.x + i, output.y + i, output.z + i,
+				tangents ? output.tx + i : NULL, tangents ? output.ty + i : NULL, tangents ? output.tz + i : NULL };
+			SampleLanes(spline, distances + i, cursor, out);
+		}
+
+		// Remaining samples:  pad a full set of lanes and copy back what is needed
+		if (i < n) {
+			float d[WIDTH], buffer[6][WIDTH];
+			for (int lane = 0; lane < WIDTH; lane++)
+				d[lane] = distances[i + (i + lane < n ? lane : 0)];
+			float* out[6] = { buffer[0], buffer[1], buffer[2], tangents ? buffer[3] : NULL, buffer[4], buffer[5] };
+			SampleLanes(spline, d, cursor, out);
+			for (size_t lane = 0; i + lane < n; lane++) {
+				output.x[i + lane] = buffer[0][lane];
+				output.y[i + lane] = buffer[1][lane];
+				output.z[i + lane] = buffer[2][lane];
+				if (tangents) {
+					output.tx[i + lane] = buffer[3][lane];
+					output.ty[i + lane] = buffer[4][lane];
+					output.tz[i + lane] = buffer[5][lane];
+				}
+			}
+		}
+	}
+};
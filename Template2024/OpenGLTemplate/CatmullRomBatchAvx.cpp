@@ -0,0 +1,33 @@
+#include "CatmullRomBatch.h"
+
+#include <immintrin.h>
+
+// AVX operations for SampleBatchSimd.  This file is compiled with AVX enabled (/arch:AVX), and SampleBatchAvx is only
+// called after SelectSampleBatchKernel has checked that the CPU supports it.
+struct AvxOperations
+{
+	typedef __m256 V;
+	enum { WIDTH = 8 };
+
+	static V Set1(float x) { return _mm256_set1_ps(x); }
+	static V Load(const float* p) { return _mm256_loadu_ps(p); }
+	static void Store(float* p, V x) { _mm256_storeu_ps(p, x); }
+	static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+	static V Sub(V a, V b) { return _mm256_sub_ps(a, b); }
+	static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static V Div(V a, V b) { return _mm256_div_ps(a, b); }
+	static V Sqrt(V a) { return _mm256_sqrt_ps(a); }
+	static V Abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static V CmpGt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static V CmpGe(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static V CmpLt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static V And(V a, V b) { return _mm256_and_ps(a, b); }
+	static V AndNot(V a, V b) { return _mm256_andnot_ps(a, b); }	// ~a & b
+	static V Select(V mask, V a, V b) { return _mm256_blendv_ps(b, a, mask); }
+	static bool AnyTrue(V mask) { return _mm256_movemask_ps(mask) != 0; }
+};
+
+void SampleBatchAvx(const SplineBatchData& spline, const float* distances, size_t n, const SplineBatchOutput& output)
+{
+	SampleBatchSimd<AvxOperations>::Run(spline, distances, n, output);
+}
@@ -0,0 +1,74 @@
+#include "CpuFeatures.h"
+
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Set once at startup, before any thread is started or kernel chosen
+static InstructionSet g_instructionSetLimit = INSTRUCTION_SET_AVX;
+
+// AVX needs support from both the CPU and the operating system (which must save the YMM registers on a context switch)
+static bool CpuSupportsAvx()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+	return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+
+// SSE2 is part of x64.  A 32-bit build may run on a CPU without it, which is left with the scalar kernels.
+static bool CpuSupportsSse2()
+{
+#if defined(_M_IX86)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[3] & (1 << 26)) != 0;
+#elif defined(__i386__)
+	return __builtin_cpu_supports("sse2") != 0;
+#else
+	return true;
+#endif
+}
+
+InstructionSet GetInstructionSet()
+{
+	InstructionSet instructionSet = INSTRUCTION_SET_SCALAR;
+	if (CpuSupportsSse2())
+		instructionSet = CpuSupportsAvx() ? INSTRUCTION_SET_AVX : INSTRUCTION_SET_SSE;
+	return instructionSet < g_instructionSetLimit ? instructionSet : g_instructionSetLimit;
+}
+
+void LimitInstructionSet(InstructionSet limit)
+{
+	g_instructionSetLimit = limit;
+}
+
+bool ParseInstructionSet(const char* name, InstructionSet& instructionSet)
+{
+	for (int i = INSTRUCTION_SET_SCALAR; i <= INSTRUCTION_SET_AVX; i++) {
+		if (strcmp(name, InstructionSetName((InstructionSet)i)) == 0) {
+			instructionSet = (InstructionSet)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char* InstructionSetName(InstructionSet instructionSet)
+{
+	switch (instructionSet) {
+	case INSTRUCTION_SET_SCALAR:
+		return "scalar";
+	case INSTRUCTION_SET_SSE:
+		return "sse";
+	default:
+		return "avx";
+	}
+}
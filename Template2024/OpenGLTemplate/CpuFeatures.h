@@ -0,0 +1,20 @@
+#pragma once
+
+// Instruction sets that are chosen between at run time, for the kernels that are compiled once per instruction set
+enum InstructionSet
+{
+	INSTRUCTION_SET_SCALAR,
+	INSTRUCTION_SET_SSE,		// SSE2
+	INSTRUCTION_SET_AVX,
+};
+
+// The widest instruction set the kernels may use:  what the CPU supports, up to the limit set below
+InstructionSet GetInstructionSet();
+
+// Keep the kernels to a narrower instruction set than the CPU supports, to compare or test them.  Kernels are chosen on
+// first use, so this must be called at startup, before any are.
+void LimitInstructionSet(InstructionSet limit);
+
+// "scalar", "sse" or "avx"
+bool ParseInstructionSet(const char* name, InstructionSet& instructionSet);
+const char* InstructionSetName(InstructionSet instructionSet);
@@ -1,5 +1,6 @@
 #pragma once
 #include "Cube.h"
+#include "RenderQueue.h"
 
 CCube::CCube()
 {}
@@ -46,6 +47,9 @@ void CCube::Create(string filename)
 	m_VBO.AddData(&t2, sizeof(glm::vec2));
 	m_VBO.AddData(&n, sizeof(glm::vec3));
 
+	glm::vec3 corners[4] = { v0, v1, v2, v3 };
+	ComputeBounds(corners, 4, m_boundingBox, m_boundingSphere);
+
 	// Upload data to GPU
 	m_VBO.UploadDataToGPU(GL_STATIC_DRAW);
 	GLsizei stride = 2 * sizeof(glm::vec3) + sizeof(glm::vec2);
@@ -70,6 +74,11 @@ void CCube::Render()
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
+void CCube::Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	queue->Submit(m_uiVAO, &m_tTexture, GL_TRIANGLE_STRIP, 0, 4, 0, modelViewMatrix);
+}
+
 void CCube::Release()
 {
 	m_tTexture.Release();
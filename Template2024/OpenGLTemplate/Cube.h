@@ -3,6 +3,9 @@
 #include "Common.h"
 #include "Texture.h"
 #include "VertexBufferObject.h"
+#include "Bounds.h"
+
+class CRenderQueue;
 
 // Class for generating a unit cube
 class CCube
@@ -12,9 +15,14 @@ public:
 	~CCube();
 	void Create(string filename);
 	void Render();
+	void Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix);
+	const BoundingBox& GetBoundingBox() const { return m_boundingBox; }
+	const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 	void Release();
 private:
 	GLuint m_uiVAO;
 	CVertexBufferObject m_VBO;
 	CTexture m_tTexture;
+	BoundingBox m_boundingBox;		// Around the vertices, in object coordinates
+	BoundingSphere m_boundingSphere;
 };
@@ -1,5 +1,7 @@
 #include "Common.h"
 #include "Diamond.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
 
 
 #define _USE_MATH_DEFINES
@@ -7,7 +9,13 @@
 
 
 CDiamond::CDiamond()
-{}
+{
+	m_vao = 0;
+	m_vertexBuffer = 0;
+	m_colourOffset = 0;
+	m_instancedVao = 0;
+	m_pInstances = NULL;
+}
 
 CDiamond::~CDiamond()
 {}
@@ -115,21 +123,38 @@ void CDiamond::Create()
 	glGenVertexArrays(1, &m_vao);
 	glBindVertexArray(m_vao);
 
-	GLuint vertex_buffer;
-	glGenBuffers(1, &vertex_buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 
 	glBufferData(GL_ARRAY_BUFFER, sizeof(diamondPos) + sizeof(diamondCol), NULL, GL_STATIC_DRAW);
 
 	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(diamondPos), diamondPos);
 	glBufferSubData(GL_ARRAY_BUFFER, sizeof(diamondPos), sizeof(diamondCol), diamondCol);
+	m_colourOffset = sizeof(diamondPos);
+	ComputeBounds((const glm::vec3*)diamondPos, 24, m_boundingBox, m_boundingSphere);
+
+	SetVertexAttributes();
+}
+
+void CDiamond::SetVertexAttributes()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
 	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (CONST GLvoid*) sizeof(diamondPos));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (CONST GLvoid*)(size_t) m_colourOffset);
+}
 
+void CDiamond::CreateInstanced(CInstanceBuffer* pInstances)
+{
+	m_pInstances = pInstances;
+	glGenVertexArrays(1, &m_instancedVao);
+	glBindVertexArray(m_instancedVao);
+	SetVertexAttributes();
+	pInstances->SetAttributes();
+	glBindVertexArray(0);
 }
 
 // Render the sphere as a set of triangles
@@ -141,10 +166,34 @@ void CDiamond::Render()
 
 }
 
+void CDiamond::Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	queue->Submit(m_vao, NULL, GL_TRIANGLES, 0, 24, 0, modelViewMatrix);
+}
+
+// One draw for every instance in the buffer given to CreateInstanced
+void CDiamond::RenderInstanced()
+{
+	if (m_pInstances->GetCount() == 0)
+		return;
+	glBindVertexArray(m_instancedVao);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 24, m_pInstances->GetCount());
+	CInstanceBuffer::SetDefaultAttributes();
+}
+
+void CDiamond::SubmitInstanced(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	if (m_pInstances->GetCount() > 0)
+		queue->Submit(m_instancedVao, NULL, GL_TRIANGLES, 0, 24, 0, modelViewMatrix, m_pInstances->GetCount());
+}
+
 // Release memory on the GPU 
 void CDiamond::Release()
 {
 	m_texture.Release();
 	glDeleteVertexArrays(1, &m_vao);
+	if (m_instancedVao != 0)
+		glDeleteVertexArrays(1, &m_instancedVao);
+	glDeleteBuffers(1, &m_vertexBuffer);
 	//m_vbo.Release();
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "EntityStore.h"
+
+CEntityStore::CEntityStore()
+{}
+
+CEntityStore::~CEntityStore()
+{}
+
+EntityHandle CEntityStore::Create(EntityKind kind, const glm::vec3& position, float distance, float lateralOffset)
+{
+	unsigned int slot;
+	if (!m_freeSlots.empty()) {
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else {
+		slot = (unsigned int)m_slots.size();
+		Slot newSlot = { 0, kind, -1 };
+		m_slots.push_back(newSlot);
+	}
+
+	EntityArchetype& archetype = m_archetypes[kind];
+	m_slots[slot].kind = kind;
+	m_slots[slot].index = archetype.Count();
+	archetype.positions.push_back(position);
+	archetype.distances.push_back(distance);
+	archetype.lateralOffsets.push_back(lateralOffset);
+	if (kind == ENTITY_VEHICLE) {
+		archetype.orientations.push_back(glm::mat3(1.0f));
+		archetype.previousPositions.push_back(position);
+		archetype.previousOrientations.push_back(glm::mat3(1.0f));
+	}
+	archetype.alive.push_back(1);
+	archetype.slots.push_back(slot);
+
+	EntityHandle handle = { slot, m_slots[slot].generation };
+	return handle;
+}
+
+bool CEntityStore::IsValid(EntityHandle handle) const
+{
+	return handle.slot < m_slots.size() && m_slots[handle.slot].generation == handle.generation &&
+		m_slots[handle.slot].index >= 0;
+}
+
+bool CEntityStore::Destroy(EntityHandle handle)
+{
+	if (!IsValid(handle))
+		return false;
+	const Slot& slot = m_slots[handle.slot];
+	RemoveAt(slot.kind, slot.index);
+	return true;
+}
+
+// Move the archetype's last entity into the hole left at index, and free the removed entity's slot
+void CEntityStore::RemoveAt(EntityKind kind, int index)
+{
+	EntityArchetype& archetype = m_archetypes[kind];
+	int last = archetype.Count() - 1;
+	unsigned int removedSlot = archetype.slots[index];
+	if (index != last) {
+		archetype.positions[index] = archetype.positions[last];
+		archetype.distances[index] = archetype.distances[last];
+		archetype.lateralOffsets[index] = archetype.lateralOffsets[last];
+		if (!archetype.orientations.empty()) {
+			archetype.orientations[index] = archetype.orientations[last];
+			archetype.previousPositions[index] = archetype.previousPositions[last];
+			archetype.previousOrientations[index] = archetype.previousOrientations[last];
+		}
+		archetype.alive[index] = archetype.alive[last];
+		archetype.slots[index] = archetype.slots[last];
+		m_slots[archetype.slots[index]].index = index;
+	}
+	archetype.positions.pop_back();
+	archetype.distances.pop_back();
+	archetype.lateralOffsets.pop_back();
+	if (!archetype.orientations.empty()) {
+		archetype.orientations.pop_back();
+		archetype.previousPositions.pop_back();
+		archetype.previousOrientations.pop_back();
+	}
+	archetype.alive.pop_back();
+	archetype.slots.pop_back();
+
+	m_slots[removedSlot].index = -1;
+	m_slots[removedSlot].generation++;
+	m_freeSlots.push_back(removedSlot);
+}
+
+// Walk backwards, so the entity swapped into a hole has already been checked
+int CEntityStore::RemoveDead(EntityKind kind)
+{
+	EntityArchetype& archetype = m_archetypes[kind];
+	int numRemoved = 0;
+	for (int i = archetype.Count() - 1; i >= 0; i--) {
+		if (!archetype.alive[i]) {
+			RemoveAt(kind, i);
+			numRemoved++;
+		}
+	}
+	return numRemoved;
+}
+
+void CEntityStore::SavePreviousState()
+{
+	EntityArchetype& vehicles = m_archetypes[ENTITY_VEHICLE];
+	vehicles.previousPositions = vehicles.positions;
+	vehicles.previousOrientations = vehicles.orientations;
+}
+
+// Destroy everything.  Slots keep their generations, so handles from before are still detected as stale.
+void CEntityStore::Clear()
+{
+	for (int kind = 0; kind < NUM_ENTITY_KINDS; kind++) {
+		EntityArchetype& archetype = m_archetypes[kind];
+		for (int i = 0; i < archetype.Count(); i++) {
+			unsigned int slot = archetype.slots[i];
+			m_slots[slot].index = -1;
+			m_slots[slot].generation++;
+			m_freeSlots.push_back(slot);
+		}
+		archetype.positions.clear();
+		archetype.distances.clear();
+		archetype.lateralOffsets.clear();
+		archetype.orientations.clear();
+		archetype.previousPositions.clear();
+		archetype.previousOrientations.clear();
+		archetype.alive.clear();
+		archetype.slots.clear();
+	}
+}
+
+EntityArchetype& CEntityStore::Archetype(EntityKind kind)
+{
+	return m_archetypes[kind];
+}
+
+int CEntityStore::Count(EntityKind kind) const
+{
+	return m_archetypes[kind].Count();
+}
+
+EntityHandle CEntityStore::Handle(EntityKind kind, int index) const
+{
+	unsigned int slot = m_archetypes[kind].slots[index];
+	EntityHandle handle = { slot, m_slots[slot].generation };
+	return handle;
+}
+
+glm::vec3& CEntityStore::Position(EntityHandle handle)
+{
+	const Slot& slot = m_slots[handle.slot];
+	return m_archetypes[slot.kind].positions[slot.index];
+}
+
+float& CEntityStore::Distance(EntityHandle handle)
+{
+	const Slot& slot = m_slots[handle.slot];
+	return m_archetypes[slot.kind].distances[slot.index];
+}
+
+float& CEntityStore::LateralOffset(EntityHandle handle)
+{
+	const Slot& slot = m_slots[handle.slot];
+	return m_archetypes[slot.kind].lateralOffsets[slot.index];
+}
+
+glm::mat3& CEntityStore::Orientation(EntityHandle handle)
+{
+	const Slot& slot = m_slots[handle.slot];
+	return m_archetypes[slot.kind].orientations[slot.index];
+}
+
+glm::vec3& CEntityStore::PreviousPosition(EntityHandle handle)
+{
+	const Slot& slot = m_slots[handle.slot];
+	return m_archetypes[slot.kind].previousPositions[slot.index];
+}
+
+glm::mat3& CEntityStore::PreviousOrientation(EntityHandle handle)
+{
+	const Slot& slot = m_slots[handle.slot];
+	return m_archetypes[slot.kind].previousOrientations[slot.index];
+}
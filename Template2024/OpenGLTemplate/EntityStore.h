@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.h"
+
+// The archetypes of entity in the game.  Entities of one archetype have the same components and are stored together.
+enum EntityKind
+{
+	ENTITY_ROCK,		// Pickup that slows the player down
+	ENTITY_DIAMOND,		// Pickup that speeds the player up
+	ENTITY_VEHICLE,		// Follows the track, with an orientation
+	NUM_ENTITY_KINDS
+};
+
+// Refers to an entity for as long as it exists.  The slot is reused once the entity is destroyed, but with a new
+// generation, so an old handle to it is detected as stale rather than referring to whatever took its place.
+struct EntityHandle
+{
+	unsigned int slot;
+	unsigned int generation;
+
+	bool operator==(const EntityHandle& other) const { return slot == other.slot && generation == other.generation; }
+};
+
+// Components of every entity of one archetype, as parallel dense arrays of Count() entries.  A loop over one component
+// reads consecutive memory.  The order of entities changes when one is removed, so hold a handle rather than an index.
+// Orientations and the state before the last simulation step are only stored for vehicles, as nothing else moves.
+struct EntityArchetype
+{
+	vector<glm::vec3> positions;
+	vector<float> distances;		// Distance along the track
+	vector<float> lateralOffsets;	// Offset from the centreline along the track's sideways vector
+	vector<glm::mat3> orientations;
+	vector<glm::vec3> previousPositions;
+	vector<glm::mat3> previousOrientations;
+	vector<unsigned char> alive;	// Cleared to have the entity removed by CEntityStore::RemoveDead
+	vector<unsigned int> slots;		// Slot of each entity, to find its handle
+
+	int Count() const { return (int)positions.size(); }
+};
+
+// Structure-of-arrays storage for the game's entities, with generational handles.  Removal swaps the last entity of
+// the archetype into the hole, so the arrays stay dense and removing costs the same however many entities there are.
+class CEntityStore
+{
+public:
+	CEntityStore();
+	~CEntityStore();
+
+	EntityHandle Create(EntityKind kind, const glm::vec3& position, float distance, float lateralOffset);
+	bool Destroy(EntityHandle handle);
+	bool IsValid(EntityHandle handle) const;
+	int RemoveDead(EntityKind kind);		// Destroy the entities whose alive flag is cleared; returns how many
+	void SavePreviousState();				// Call before each simulation step, for rendering between steps
+	void Clear();
+
+	EntityArchetype& Archetype(EntityKind kind);
+	int Count(EntityKind kind) const;
+	EntityHandle Handle(EntityKind kind, int index) const;
+
+	// Components of one entity.  The handle must be valid.
+	glm::vec3& Position(EntityHandle handle);
+	float& Distance(EntityHandle handle);
+	float& LateralOffset(EntityHandle handle);
+	glm::mat3& Orientation(EntityHandle handle);		// Vehicles only
+	glm::vec3& PreviousPosition(EntityHandle handle);	// Before the last simulation step; vehicles only
+	glm::mat3& PreviousOrientation(EntityHandle handle);
+
+private:
+	// Where an entity lives.  A free slot has index -1 and is on m_freeSlots.
+	struct Slot
+	{
+		unsigned int generation;
+		EntityKind kind;
+		int index;			// Position in the archetype's arrays
+	};
+
+	void RemoveAt(EntityKind kind, int index);
+
+	EntityArchetype m_archetypes[NUM_ENTITY_KINDS];
+	vector<Slot> m_slots;
+	vector<unsigned int> m_freeSlots;
+};
@@ -0,0 +1,29 @@
+#include "FrameSnapshot.h"
+
+#include "./include/glm/gtc/quaternion.hpp"
+
+// Spherical interpolation, so the orientation stays a rotation part way through a turn
+glm::mat4 VehicleSnapshot::Transform(float alpha) const
+{
+	glm::quat rotation = glm::slerp(glm::quat_cast(previousOrientation), glm::quat_cast(orientation), alpha);
+	glm::mat4 transform = glm::mat4_cast(rotation);
+	transform[3] = glm::vec4(glm::mix(previousPosition, position, alpha), 1.0f);
+	return transform;
+}
+
+FrameSnapshot::FrameSnapshot()
+{
+	time = 0.0;
+	tick = 0;
+	alive = true;
+	score = 0.0;
+	cameraDistance = 0.0f;
+	for (int i = 0; i < 2; i++) {
+		cameraPosition[i] = glm::vec3(0.0f);
+		cameraView[i] = glm::vec3(0.0f, 0.0f, -1.0f);
+		cameraUp[i] = glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+	VehicleSnapshot vehicle = { glm::vec3(0.0f), glm::vec3(0.0f), glm::mat3(1.0f), glm::mat3(1.0f) };
+	spaceShip = vehicle;
+	policeCar = vehicle;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common.h"
+
+// A vehicle before and after the last simulation step
+struct VehicleSnapshot
+{
+	glm::vec3 previousPosition;
+	glm::vec3 position;
+	glm::mat3 previousOrientation;
+	glm::mat3 orientation;
+
+	glm::mat4 Transform(float alpha) const;		// A fraction alpha of the way from the previous state to the current one
+};
+
+// Everything Render needs from the simulation, copied out after a simulation step so the simulation can carry on
+// while the frame is drawn.  Passed from the simulation thread to the render thread through a CTripleBuffer.
+struct FrameSnapshot
+{
+	double time;				// Clock time in milliseconds that the current state is for
+	int tick;					// Simulation steps so far; 0 until the first step
+	bool alive;
+	double score;
+	float cameraDistance;		// Distance along the track of the followed camera, for streaming the track around it
+	glm::vec3 cameraPosition[2];	// Followed camera before and after the last step
+	glm::vec3 cameraView[2];
+	glm::vec3 cameraUp[2];
+	VehicleSnapshot spaceShip;
+	VehicleSnapshot policeCar;
+	vector<glm::vec3> rockPositions;	// Pickups not yet collected
+	vector<glm::vec3> diamondPositions;
+	vector<float> diamondDistances;		// Along the track, which does not change as pickups are collected
+
+	FrameSnapshot();
+};
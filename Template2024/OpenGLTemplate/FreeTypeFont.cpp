@@ -1,5 +1,6 @@
 #include "FreeTypeFont.h"
 #include <minmax.h>
+#include "Profiler.h"
 
 #pragma comment(lib, "lib/freetype.lib")
 
@@ -80,6 +81,8 @@ void CFreeTypeFont::CreateChar(int index)
 // Loads an entire font with the given path sFile and pixel size iPXSize
 bool CFreeTypeFont::LoadFont(string file, int ipixelSize)
 {
+	PROFILE_ZONE("Font::Load");
+
 	BOOL bError = FT_Init_FreeType(&m_ftLib);
 	
 	bError = FT_New_Face(m_ftLib, file.c_str(), 0, &m_ftFace);
@@ -152,7 +155,7 @@ void CFreeTypeFont::Print(string text, int x, int y, int pixelSize)
 			m_charTextures[iIndex].Bind();
 			glm::mat4 mModelView = glm::translate(glm::mat4(1.0f), glm::vec3(float(iCurX), float(iCurY), 0.0f));
 			mModelView = glm::scale(mModelView, glm::vec3(fScale));
-			m_shaderProgram->SetUniform("matrices.modelViewMatrix", mModelView);
+			m_shaderProgram->SetUniform(m_modelViewMatrixUniform, mModelView);
 			// Draw character
 			glDrawArrays(GL_TRIANGLE_STRIP, iIndex*4, 4);
 		}
@@ -196,4 +199,5 @@ int CFreeTypeFont::GetTextWidth(string sText, int iPixelSize)
 void CFreeTypeFont::SetShaderProgram(CShaderProgram* shaderProgram)
 {
 	m_shaderProgram = shaderProgram;
+	m_modelViewMatrixUniform = shaderProgram->GetUniform<glm::mat4>("matrices.modelViewMatrix");
 }
\ No newline at end of file
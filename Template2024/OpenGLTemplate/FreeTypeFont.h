@@ -46,4 +46,5 @@ private:
 	FT_Library m_ftLib;
 	FT_Face m_ftFace;
 	CShaderProgram* m_shaderProgram;
+	UniformHandle<glm::mat4> m_modelViewMatrixUniform;	// Set once per character
 };
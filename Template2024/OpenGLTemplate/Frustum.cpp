@@ -0,0 +1,60 @@
+#include "Frustum.h"
+
+// The vectors keep their storage from frame to frame, so refilling the list does not allocate once it has grown
+void SphereList::Clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	radius.clear();
+	visible.clear();
+}
+
+void SphereList::Add(const BoundingSphere& sphere)
+{
+	x.push_back(sphere.centre.x);
+	y.push_back(sphere.centre.y);
+	z.push_back(sphere.centre.z);
+	radius.push_back(sphere.radius);
+}
+
+CFrustum::CFrustum()
+{
+	// With no planes set, nothing is culled
+	for (int p = 0; p < NUM_FRUSTUM_PLANES; p++) {
+		for (int i = 0; i < 4; i++)
+			m_planes[p][i] = i == 3 ? 1.0f : 0.0f;
+	}
+}
+
+void CFrustum::SetPlanes(const glm::vec4 planes[NUM_FRUSTUM_PLANES])
+{
+	for (int p = 0; p < NUM_FRUSTUM_PLANES; p++) {
+		for (int i = 0; i < 4; i++)
+			m_planes[p][i] = planes[p][i];
+	}
+}
+
+bool CFrustum::IsVisible(const BoundingSphere& sphere) const
+{
+	return SphereInFrustum(m_planes, sphere.centre.x, sphere.centre.y, sphere.centre.z, sphere.radius);
+}
+
+void CFrustum::Cull(SphereList& spheres) const
+{
+	// Widest kernel supported by this CPU, chosen on first use.  As in CCatmullRom::SampleBatch, a local static is
+	// initialised safely even if the first calls come from several threads at once.
+	static const CullSpheresKernel kernel = SelectCullSpheresKernel();
+	Cull(kernel, spheres);
+}
+
+void CFrustum::Cull(CullSpheresKernel kernel, SphereList& spheres) const
+{
+	size_t n = spheres.Size();
+	spheres.visible.resize(n);
+	if (n == 0)
+		return;
+
+	SphereBatchData batch = { &spheres.x[0], &spheres.y[0], &spheres.z[0], &spheres.radius[0] };
+	kernel(m_planes, batch, n, &spheres.visible[0]);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Common.h"
+#include "Bounds.h"
+#include "FrustumCull.h"
+
+// Spheres gathered for testing together, as a structure of arrays so the kernels can load several of each at once
+struct SphereList
+{
+	vector<float> x;
+	vector<float> y;
+	vector<float> z;
+	vector<float> radius;
+	vector<unsigned char> visible;		// Filled by CFrustum::Cull
+
+	void Clear();
+	void Add(const BoundingSphere& sphere);
+	size_t Size() const { return x.size(); }
+};
+
+// The camera's view volume in world coordinates, for dropping objects before they are queued, so that an object out of
+// view costs no uniforms or draw calls.  Single objects are tested one at a time with IsVisible; large numbers of
+// similar objects, such as the pickups, are gathered into a SphereList and tested by the widest kernel the CPU has.
+class CFrustum
+{
+public:
+	CFrustum();
+
+	void SetPlanes(const glm::vec4 planes[NUM_FRUSTUM_PLANES]);	// As given by CCamera::GetFrustumPlanes
+	bool IsVisible(const BoundingSphere& sphere) const;
+	void Cull(SphereList& spheres) const;
+	void Cull(CullSpheresKernel kernel, SphereList& spheres) const;		// With the given kernel, to compare them
+
+private:
+	float m_planes[NUM_FRUSTUM_PLANES][4];
+};
@@ -0,0 +1,43 @@
+#include "FrustumCull.h"
+#include "CpuFeatures.h"
+
+#include <emmintrin.h>
+
+// Scalar fallback:  one sphere at a time
+void CullSpheresScalar(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n, unsigned char* visible)
+{
+	for (size_t i = 0; i < n; i++)
+		visible[i] = SphereInFrustum(planes, spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i]) ? 1 : 0;
+}
+
+// SSE operations for CullSpheresSimd.  SSE2 is part of x64; only a 32-bit build checks for it (see GetInstructionSet).
+struct SseCullOperations
+{
+	typedef __m128 V;
+	enum { WIDTH = 4 };
+
+	static V Set1(float x) { return _mm_set1_ps(x); }
+	static V Load(const float* p) { return _mm_loadu_ps(p); }
+	static V Add(V a, V b) { return _mm_add_ps(a, b); }
+	static V Mul(V a, V b) { return _mm_mul_ps(a, b); }
+	static V CmpGe(V a, V b) { return _mm_cmpge_ps(a, b); }
+	static int MoveMask(V mask) { return _mm_movemask_ps(mask); }
+};
+
+void CullSpheresSse(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n, unsigned char* visible)
+{
+	CullSpheresSimd<SseCullOperations>::Run(planes, spheres, n, visible);
+}
+
+// Pick the widest kernel the machine supports, or the one -isa limits the game to
+CullSpheresKernel SelectCullSpheresKernel()
+{
+	switch (GetInstructionSet()) {
+	case INSTRUCTION_SET_AVX:
+		return CullSpheresAvx;
+	case INSTRUCTION_SET_SSE:
+		return CullSpheresSse;
+	default:
+		return CullSpheresScalar;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+
+// Sphere-frustum tests shared by CFrustum and the CullSpheres kernels.  Like the SampleBatch kernels, these are compiled
+// once per instruction set (FrustumCull.cpp for scalar and SSE, FrustumCullAvx.cpp with AVX enabled), so they work on
+// plain arrays rather than on the class.
+//
+// The six planes are (a, b, c, d) with unit normals (a, b, c) pointing into the frustum.  A sphere is kept unless it
+// lies wholly outside one plane, ax + by + cz + d < -r.  A sphere near a corner may pass every plane and still be
+// outside, which only costs a draw that is clipped.
+
+static const int NUM_FRUSTUM_PLANES = 6;
+
+// Structure-of-arrays spheres
+struct SphereBatchData
+{
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* radius;
+};
+
+// visible[i] is set to 1 if sphere i may be seen, or 0 if it is wholly outside the frustum
+typedef void (*CullSpheresKernel)(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n,
+	unsigned char* visible);
+
+void CullSpheresScalar(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n, unsigned char* visible);
+void CullSpheresSse(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n, unsigned char* visible);
+void CullSpheresAvx(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n, unsigned char* visible);
+CullSpheresKernel SelectCullSpheresKernel();
+
+inline bool SphereInFrustum(const float planes[NUM_FRUSTUM_PLANES][4], float x, float y, float z, float radius)
+{
+	for (int p = 0; p < NUM_FRUSTUM_PLANES; p++) {
+		if (planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] < -radius)
+			return false;
+	}
+	return true;
+}
+
+// SIMD kernel, instantiated with an operations struct S for each instruction set.  S provides a vector type V of WIDTH
+// floats, Set1, Load, Add, Mul, CmpGe and And, and MoveMask, which packs the lane masks into the low bits of an int.
+template <class S>
+struct CullSpheresSimd
+{
+	typedef typename S::V V;
+	enum { WIDTH = S::WIDTH };
+
+	// Bit i of the result is set if lane i is visible.  The lanes are tested against one plane at a time, stopping
+	// once every lane is outside; most spheres that are culled fail the first plane or two.
+	static int CullLanes(const float planes[NUM_FRUSTUM_PLANES][4], const float* x, const float* y, const float* z,
+		const float* radius)
+	{
+		V px = S::Load(x), py = S::Load(y), pz = S::Load(z), r = S::Load(radius);
+		V zero = S::Set1(0.0f);
+		int visible = (1 << WIDTH) - 1;
+		for (int p = 0; p < NUM_FRUSTUM_PLANES && visible != 0; p++) {
+			V distance = S::Add(S::Add(S::Mul(S::Set1(planes[p][0]), px), S::Mul(S::Set1(planes[p][1]), py)),
+				S::Add(S::Mul(S::Set1(planes[p][2]), pz), S::Add(S::Set1(planes[p][3]), r)));
+			visible &= S::MoveMask(S::CmpGe(distance, zero));
+		}
+		return visible;
+	}
+
+	static void Run(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n,
+		unsigned char* visible)
+	{
+		size_t i = 0;
+		for (; i + WIDTH <= n; i += WIDTH) {
+			int mask = CullLanes(planes, spheres.x + i, spheres.y + i, spheres.z + i, spheres.radius + i);
+			for (int lane = 0; lane < WIDTH; lane++)
+				visible[i + lane] = (unsigned char)((mask >> lane) & 1);
+		}
+
+		// Remaining spheres:  pad a full set of lanes and copy back what is needed
+		if (i < n) {
+			float buffer[4][WIDTH];
+			for (int lane = 0; lane < WIDTH; lane++) {
+				size_t j = i + (i + lane < n ? lane : 0);
+				buffer[0][lane] = spheres.x[j];
+				buffer[1][lane] = spheres.y[j];
+				buffer[2][lane] = spheres.z[j];
+				buffer[3][lane] = spheres.radius[j];
+			}
+			int mask = CullLanes(planes, buffer[0], buffer[1], buffer[2], buffer[3]);
+			for (size_t lane = 0; i + lane < n; lane++)
+				visible[i + lane] = (unsigned char)((mask >> lane) & 1);
+		}
+	}
+};
@@ -0,0 +1,23 @@
+#include "FrustumCull.h"
+
+#include <immintrin.h>
+
+// AVX operations for CullSpheresSimd.  This file is compiled with AVX enabled (/arch:AVX), and CullSpheresAvx is only
+// called after SelectCullSpheresKernel has checked that the CPU supports it.
+struct AvxCullOperations
+{
+	typedef __m256 V;
+	enum { WIDTH = 8 };
+
+	static V Set1(float x) { return _mm256_set1_ps(x); }
+	static V Load(const float* p) { return _mm256_loadu_ps(p); }
+	static V Add(V a, V b) { return _mm256_add_ps(a, b); }
+	static V Mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static V CmpGe(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static int MoveMask(V mask) { return _mm256_movemask_ps(mask); }
+};
+
+void CullSpheresAvx(const float planes[NUM_FRUSTUM_PLANES][4], const SphereBatchData& spheres, size_t n, unsigned char* visible)
+{
+	CullSpheresSimd<AvxCullOperations>::Run(planes, spheres, n, visible);
+}
@@ -26,6 +26,7 @@ Source code drawn from a number of sources and examples, including contributions
 
 #include "game.h"
 #include "CatmullRom.h"
+#include "TrackStreamer.h"
 
 
 // Setup includes
@@ -44,6 +45,31 @@ Source code drawn from a number of sources and examples, including contributions
 #include "Audio.h"
 #include "Diamond.h"
 #include "Cube.h"
+#include "HeadlessContext.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "PickupPlacer.h"
+#include "TrackBroadphase.h"
+#include "UniformBuffers.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "CpuFeatures.h"
+#include "TrackFile.h"
+
+const double Game::SIMULATION_STEP = 1000.0 / 120.0;
+static const float FAR_CLIPPING_PLANE = 5000.0f;
+static const float DIAMOND_PHASE_PER_UNIT = 0.5f;	// Radians of starting angle per unit of track distance
+
+// A sphere around every instance of a mesh with the given bounds, in world coordinates
+static BoundingSphere InstanceBounds(const BoundingSphere& meshBounds, const vector<InstanceData>& instances)
+{
+	if (instances.empty())
+		return BoundingSphere();
+	BoundingSphere bounds = TransformSphere(meshBounds, instances[0].modelMatrix);
+	for (size_t i = 1; i < instances.size(); i++)
+		bounds = MergeSpheres(bounds, TransformSphere(meshBounds, instances[i].modelMatrix));
+	return bounds;
+}
 
 // Constructor
 Game::Game()
@@ -62,17 +88,33 @@ Game::Game()
 	m_pHighResolutionTimer = NULL;
 	m_pAudio = NULL;
 	m_pCatmullRom = NULL;
+	m_pTrackStreamer = NULL;
+	m_pEntityStore = NULL;
+	m_pBroadphase = NULL;
 	m_pDiamond = NULL;
 	m_pCube = NULL;
+	m_pHeadlessContext = NULL;
+	m_pPlatform = NULL;
+	m_pUniformBuffers = NULL;
+	m_pRenderQueue = NULL;
+	m_pRockInstances = NULL;
+	m_pDiamondInstances = NULL;
+	m_pSphereInstances = NULL;
+	m_pBarrelInstances = NULL;
 
 
 	m_dt = 0.0;
+	m_simulationTime = 0.0;
+	m_simulationTicks = 0;
+	m_interpolation = 0.0f;
+	m_pClock = NULL;
+	m_simulationRunning = false;
+	m_bThreadedSimulation = true;
+	m_appActive = false;
 	m_framesPerSecond = 0;
 	m_frameCount = 0;
 	m_elapsedTime = 0.0f;
 	m_currentDistance = 0.0f;
-	m_currentDistance1 = 20.0f;
-	m_currentDistance2 = -100.0f;
 	m_multiplier = 0.05f;
 	m_cameraRotation = 0.0f;
 	m_offSet = 0.0f;
@@ -82,11 +124,18 @@ Game::Game()
 	m_score = 0.0;
 	m_topScore = 0.0;
 	m_scoreMultiplier = 1.0;
+	m_bShowProfiler = false;
+	m_trackFilename = "resources\\tracks\\default.trk";
+	m_numRocks = 7;
+	m_numDiamonds = 5;
+	m_pickupSeed = 1;
 }
 
 // Destructor
 Game::~Game() 
-{ 
+{
+	StopSimulationThread();
+
 	//game objects
 	delete m_pCamera;
 	delete m_pSkybox;
@@ -99,9 +148,18 @@ Game::~Game()
 	delete m_pRock;
 	delete m_pSphere;
 	delete m_pAudio;
+	delete m_pTrackStreamer;
+	delete m_pEntityStore;
+	delete m_pBroadphase;
 	delete m_pCatmullRom;
 	delete m_pDiamond;
 	delete m_pCube;
+	delete m_pUniformBuffers;
+	delete m_pRenderQueue;
+	delete m_pRockInstances;
+	delete m_pDiamondInstances;
+	delete m_pSphereInstances;
+	delete m_pBarrelInstances;
 
 
 	if (m_pShaderPrograms != NULL) {
@@ -112,11 +170,15 @@ Game::~Game()
 
 	//setup objects
 	delete m_pHighResolutionTimer;
+	delete m_pClock;
+	delete m_pHeadlessContext;
 }
 
 // Initialisation:  This method only runs once at startup
 void Game::Initialise() 
 {
+	PROFILE_ZONE("Initialise");
+
 	// Set the clear colour and depth
 	glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
 	glClearDepth(1.0f);
@@ -135,33 +197,36 @@ void Game::Initialise()
 	m_pRock = new COpenAssetImportMesh;
 	m_pSphere = new CSphere;
 	m_pAudio = new CAudio;
-	m_pCatmullRom = new CCatmullRom;
+	m_pTrackStreamer = new CTrackStreamer;
+	m_pEntityStore = new CEntityStore;
+	m_pBroadphase = new CTrackBroadphase;
 	m_pDiamond = new CDiamond;
 	m_pCube = new CCube;
+	m_pUniformBuffers = new CUniformBuffers;
+	m_pRenderQueue = new CRenderQueue;
+	m_pRockInstances = new CInstanceBuffer;
+	m_pDiamondInstances = new CInstanceBuffer;
+	m_pSphereInstances = new CInstanceBuffer;
+	m_pBarrelInstances = new CInstanceBuffer;
 
 
-	//m_pCatmullRom->CreatePath(p0,p1,p2,p3);
+	{
+	PROFILE_ZONE("Create track");
 	m_pCatmullRom -> CreateCentreline();
 	m_pCatmullRom->CreateOffsetCurves();
-	m_pCatmullRom->CreatePath("resources\\textures\\black-gypsum-wall.jpg"); //https://www.freepik.com/free-photo/black-gypsum-wall_1037501.htm#query=asphalt%20texture%20seamless&position=1&from_view=keyword&track=ais&uuid=dad16982-4819-4efd-b576-3032b7b4c1f1#position=1&query=asphalt%20texture%20seamless
+	m_pTrackStreamer->Create(m_pCatmullRom, "resources\\textures\\black-gypsum-wall.jpg"); //https://www.freepik.com/free-photo/black-gypsum-wall_1037501.htm#query=asphalt%20texture%20seamless&position=1&from_view=keyword&track=ais&uuid=dad16982-4819-4efd-b576-3032b7b4c1f1#position=1&query=asphalt%20texture%20seamless
 	m_pCube->Create("resources\\textures\\concrete-wall-texture.jpg");
+	}
 	m_t = 0;
-	m_spaceShipPosition = glm::vec3(0,0,0);
-	m_spaceShipOrientation = glm::mat4(0, 0, 0, 0,
-		0, 0, 0, 0,
-		0, 0, 0, 0,
-		0, 0, 0, 0);
-
 
 
-	RECT dimensions = m_gameWindow.GetDimensions();
 
-	int width = dimensions.right - dimensions.left;
-	int height = dimensions.bottom - dimensions.top;
+	int width = m_pPlatform->GetWidth();
+	int height = m_pPlatform->GetHeight();
 
 	// Set the orthographic and perspective projection matrices based on the image size
 	m_pCamera->SetOrthographicProjectionMatrix(width, height); 
-	m_pCamera->SetPerspectiveProjectionMatrix(45.0f, (float) width / (float) height, 0.5f, 5000.0f);
+	m_pCamera->SetPerspectiveProjectionMatrix(45.0f, (float) width / (float) height, 0.5f, FAR_CLIPPING_PLANE);
 
 	// Load shaders
 	vector<CShader> shShaders;
@@ -214,11 +279,21 @@ void Game::Initialise()
 	pDiamondProgram->LinkProgram();
 	m_pShaderPrograms->push_back(pDiamondProgram);
 
+	m_useTextureUniform = pMainProgram->GetUniform<int>("bUseTexture");
+
+	// Every program shares the frame, material and object uniform blocks
+	m_pUniformBuffers->Create();
+	for (size_t i = 0; i < m_pShaderPrograms->size(); i++)
+		m_pUniformBuffers->BindProgram((*m_pShaderPrograms)[i]);
+
 	// You can follow this pattern to load additional shaders
 
 	// Create the skybox
 	// Skybox downloaded from http://www.akimbo.in/forum/viewtopic.php?f=10&t=9
+	{
+	PROFILE_ZONE("Create skybox");
 	m_pSkybox->Create(2500.0f);
+	}
 	
 	// Create the planar terrain
 	m_pPlanarTerrain->Create("resources\\textures\\", "Sci-fi_Floor_003_basecolor.jpg", 2000.0f, 2000.0f, 50.0f); // Texture downloaded from http://www.psionicgames.com/?page_id=26 on 24 Jan 2013
@@ -238,24 +313,80 @@ void Game::Initialise()
 	m_pDiamond->Create();
 	glEnable(GL_CULL_FACE);
 
+	// The rocks, diamonds, spheres and barrels are each drawn with one instanced draw.  The rocks and diamonds are
+	// refilled every frame; the spheres and barrels do not move.
+	m_pRockInstances->Create();
+	m_pDiamondInstances->Create();
+	m_pSphereInstances->Create();
+	m_pBarrelInstances->Create();
+	m_pRock->CreateInstanced(m_pRockInstances);
+	m_pDiamond->CreateInstanced(m_pDiamondInstances);
+	m_pSphere->CreateInstanced(m_pSphereInstances);
+	m_pBarrelMesh->CreateInstanced(m_pBarrelInstances);
+	CInstanceBuffer::SetDefaultAttributes();
+
+	InstanceData instance;
+	instance.colour = glm::vec4(1.0f);
+	instance.phase = 0.0f;
+	instance.spin = 0.0f;
+	m_instances.clear();
+	instance.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 2.0f, 150.0f)), glm::vec3(2.0f));
+	m_instances.push_back(instance);
+	instance.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 6.0f, 160.0f)), glm::vec3(2.0f * 3));
+	m_instances.push_back(instance);
+	m_pSphereInstances->Upload(m_instances);
+	m_sphereGroupBounds = InstanceBounds(m_pSphere->GetBoundingSphere(), m_instances);
+
+	m_instances.clear();
+	for (int i = 0; i < 3; i++) {
+		instance.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(100.0f + 50.0f * i, 0.0f, 0.0f)), glm::vec3(5.0f));
+		m_instances.push_back(instance);
+	}
+	m_pBarrelInstances->Upload(m_instances);
+	m_barrelGroupBounds = InstanceBounds(m_pBarrelMesh->GetBoundingSphere(), m_instances);
+
 	// Initialise audio and play background music
 	m_pAudio->Initialise();
 	m_pAudio->LoadEventSound("resources\\Audio\\Boing.wav");					// Royalty free sound from freesound.org
 	//m_pAudio->LoadMusicStream("resources\\Audio\\DST-Garote.mp3");	// Royalty free music from http://www.nosoapradio.us/
 	m_pAudio->PlayMusicStream();
 
-	for (int i = 0; i < 20; i++) {
-		RockPositions.push_back(m_pCatmullRom->RandomPos());
-	}
+	CreateEntities();
+}
 
-	for (int i = 0; i < 20; i++) {
-		DiamondPositions.push_back(m_pCatmullRom->RandomPos());
+// The spaceship starts just ahead of the camera and the police car behind it, both placed by the first update
+void Game::CreateEntities()
+{
+	m_pEntityStore->Clear();
+	m_spaceShip = m_pEntityStore->Create(ENTITY_VEHICLE, glm::vec3(0.0f), 20.0f, m_offSet);
+	m_policeCar = m_pEntityStore->Create(ENTITY_VEHICLE, glm::vec3(0.0f), -100.0f, m_offSet);
+	PlacePickups();
+	m_pBroadphase->Build(*m_pEntityStore, m_pCatmullRom->Length());
+}
+
+// Scatter the rocks and diamonds over the road, far enough apart that no two overlap
+void Game::PlacePickups()
+{
+	// Further apart than a rock and a diamond can both be touched from, and clear of the kerbs
+	const float spacing = 10.0f, halfWidth = 13.0f;
+
+	CPickupPlacer placer;
+	vector<PickupPlacement> placements;
+	placer.Place(m_pickupSeed, m_numRocks + m_numDiamonds, spacing, m_pCatmullRom->Length(), halfWidth, placements);
+
+	for (int i = 0; i < (int)placements.size(); i++) {
+		CurveFrame frame;
+		m_pCatmullRom->SampleFrame(placements[i].distance, frame);
+		glm::vec3 position = frame.position + placements[i].lateralOffset * frame.Side();
+		m_pEntityStore->Create(i < m_numRocks ? ENTITY_ROCK : ENTITY_DIAMOND, position, placements[i].distance,
+			placements[i].lateralOffset);
 	}
 }
 
 // Render method runs repeatedly in a loop
 void Game::Render()
 {
+	PROFILE_ZONE("Render");
 
 	// Clear the buffers and enable depth testing (z-buffering)
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -265,321 +396,399 @@ void Game::Render()
 	glutil::MatrixStack modelViewMatrixStack;
 	modelViewMatrixStack.SetIdentity();
 
+	// The latest simulation state, taken by Update
+	const FrameSnapshot& snapshot = m_snapshots.Front();
+
 	// Use the main shader program 
 	CShaderProgram* pMainProgram = (*m_pShaderPrograms)[0];
 	pMainProgram->UseProgram();
-	pMainProgram->SetUniform("bUseTexture", true);
+	pMainProgram->SetUniform(m_useTextureUniform, true);
 	pMainProgram->SetUniform("sampler0", 0);
 	// Note: cubemap and non-cubemap textures should not be mixed in the same texture unit.  Setting unit 10 to be a cubemap texture.
 	int cubeMapTextureUnit = 10;
 	pMainProgram->SetUniform("CubeMapTex", cubeMapTextureUnit);
 
 
-	// Set the projection matrix
-	pMainProgram->SetUniform("matrices.projMatrix", m_pCamera->GetPerspectiveProjectionMatrix());
-
 	// Call LookAt to create the view matrix and put this on the modelViewMatrix stack. 
 	// Store the view matrix and the normal matrix associated with the view matrix for later (they're useful for lighting -- since lighting is done in eye coordinates)
 	modelViewMatrixStack.LookAt(m_pCamera->GetPosition(), m_pCamera->GetView(), m_pCamera->GetUpVector());
 	glm::mat4 viewMatrix = modelViewMatrixStack.Top();
 	glm::mat3 viewNormalMatrix = m_pCamera->ComputeNormalMatrix(viewMatrix);
 
+	// Objects wholly outside the view frustum are dropped before they are queued, so they cost no uniforms or draws.
+	// The frustum is in world coordinates:  objects placed on the matrix stack are brought back by the inverse view.
+	glm::vec4 frustumPlanes[NUM_FRUSTUM_PLANES];
+	m_pCamera->GetFrustumPlanes(frustumPlanes);
+	CFrustum frustum;
+	frustum.SetPlanes(frustumPlanes);
+	glm::mat4 inverseViewMatrix = glm::inverse(viewMatrix);
+
 
-	// Set light and materials in main shader program
+	// Set the projection matrix and light for every shader program at once
+	m_pUniformBuffers->BeginFrame();
+	FrameUniforms frame;
+	frame.projMatrix = *m_pCamera->GetPerspectiveProjectionMatrix();
 	glm::vec4 lightPosition1 = glm::vec4(-100, 100, -100, 1); // Position of light source *in world coordinates*
-	pMainProgram->SetUniform("light1.position", viewMatrix * lightPosition1); // Position of light source *in eye coordinates*
-	pMainProgram->SetUniform("light1.La", glm::vec3(0.5f));		// Ambient colour of light
-	pMainProgram->SetUniform("light1.Ld", glm::vec3(0.5f));		// Diffuse colour of light
-	pMainProgram->SetUniform("light1.Ls", glm::vec3(0.5f));		// Specular colour of light
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(1.0f));	// Ambient material reflectance
-	pMainProgram->SetUniform("material1.Md", glm::vec3(0.0f));	// Diffuse material reflectance
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(0.0f));	// Specular material reflectance
-	pMainProgram->SetUniform("material1.shininess", 15.0f);		// Shininess material property
-
-
-	// Render the skybox and terrain with full ambient reflectance 
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("renderSkybox", true);
-	// Translate the modelview matrix to the camera eye point so skybox stays centred around camera
-	glm::vec3 vEye = m_pCamera->GetPosition();
-	modelViewMatrixStack.Translate(vEye);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pSkybox->Render(cubeMapTextureUnit);
-	pMainProgram->SetUniform("renderSkybox", false);
-	modelViewMatrixStack.Pop();
-
-	// Render the planar terrain
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pPlanarTerrain->Render();
-	modelViewMatrixStack.Pop();
-
-
-	// Turn on diffuse + specular materials
-	pMainProgram->SetUniform("material1.Ma", glm::vec3(0.5f));	// Ambient material reflectance
-	pMainProgram->SetUniform("material1.Md", glm::vec3(0.5f));	// Diffuse material reflectance
-	pMainProgram->SetUniform("material1.Ms", glm::vec3(1.0f));	// Specular material reflectance	
-
-
-	// Render the horse 
-	/*modelViewMatrixStack.Push();
-		modelViewMatrixStack.Translate(glm::vec3(0.0f, 0.0f, 0.0f));
-		modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), 180.0f);
-		modelViewMatrixStack.Scale(2.5f);
-		pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-		pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-		m_pHorseMesh->Render();
-	modelViewMatrixStack.Pop();*/
+	frame.light1.position = viewMatrix * lightPosition1;	// Position of light source *in eye coordinates*
+	frame.light1.La = glm::vec3(0.5f);		// Ambient colour of light
+	frame.light1.Ld = glm::vec3(0.5f);		// Diffuse colour of light
+	frame.light1.Ls = glm::vec3(0.5f);		// Specular colour of light
+	frame.time = (float)(m_pClock->Elapsed() / 1000.0);
+	m_pUniformBuffers->SetFrame(frame);
+
+	// Full ambient reflectance for the skybox and terrain, then diffuse + specular materials for everything else
+	m_pRenderQueue->Begin(FAR_CLIPPING_PLANE);
+	MaterialUniforms material;
+	material.Ma = glm::vec3(1.0f);		// Ambient material reflectance
+	material.Md = glm::vec3(0.0f);		// Diffuse material reflectance
+	material.Ms = glm::vec3(0.0f);		// Specular material reflectance
+	material.shininess = 15.0f;			// Shininess material property
+	int ambientMaterial = m_pRenderQueue->AddMaterial(material);
+	material.Ma = glm::vec3(0.5f);	// Ambient material reflectance
+	material.Md = glm::vec3(0.5f);	// Diffuse material reflectance
+	material.Ms = glm::vec3(1.0f);	// Specular material reflectance
+	int shinyMaterial = m_pRenderQueue->AddMaterial(material);
+
+
+	// Render the skybox first, straight away:  it does not write depth, so everything else is drawn over it
+	{
+		PROFILE_RENDER_ZONE("Skybox");
 
-	if (m_bAlive) {
+		m_pUniformBuffers->SetMaterial(m_pRenderQueue->GetMaterial(ambientMaterial));
 		modelViewMatrixStack.Push();
-		modelViewMatrixStack.Translate(m_spaceShipPosition);
-		modelViewMatrixStack *= m_spaceShipOrientation;
-		modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(180.0f));
-		modelViewMatrixStack.Scale(0.02f);
-		pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-		pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-		m_pCarMesh->Render();
+		pMainProgram->SetUniform("renderSkybox", true);
+		// Translate the modelview matrix to the camera eye point so skybox stays centred around camera
+		glm::vec3 vEye = m_pCamera->GetPosition();
+		modelViewMatrixStack.Translate(vEye);
+		m_pUniformBuffers->SetObject(modelViewMatrixStack.Top(), m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
+		m_pSkybox->Render(cubeMapTextureUnit);
+		pMainProgram->SetUniform("renderSkybox", false);
 		modelViewMatrixStack.Pop();
+	}
 
-		modelViewMatrixStack.Push();
-		modelViewMatrixStack.Translate(m_PoliceCarPosition);
-		modelViewMatrixStack *= m_PoliceCarOrientation;
-		modelViewMatrixStack.Rotate(glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(90.0f));
-		modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(90.0f));
-		modelViewMatrixStack.Scale(2.0f);
-		pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-		pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-		m_pPoliceCarMesh->Render();
-		modelViewMatrixStack.Pop();
+	// Everything else is queued, then drawn sorted by program, material, texture and VAO
+	{
+		PROFILE_ZONE("Submit");
 
-		for (int i = 0; i < 7; i++) {
-			modelViewMatrixStack.Push();
-			modelViewMatrixStack.Translate(RockPositions[i]);
-			modelViewMatrixStack.Scale(2.0f);
-			pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-			pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-			m_pRock->Render();
-			modelViewMatrixStack.Pop();
-		}
+		m_pRenderQueue->SetProgram(pMainProgram);
 
+		// Render the planar terrain
+		m_pRenderQueue->SetMaterial(ambientMaterial);
+		if (frustum.IsVisible(m_pPlanarTerrain->GetBoundingSphere()))
+			m_pPlanarTerrain->Submit(m_pRenderQueue, modelViewMatrixStack.Top());
 
-	}
-	//render diamond------------------------
-	CShaderProgram* pDiamondProgram = (*m_pShaderPrograms)[2];
-	pDiamondProgram->UseProgram();
-	// Set the projection matrix
-	pDiamondProgram->SetUniform("matrices.projMatrix", m_pCamera->GetPerspectiveProjectionMatrix());
+		m_pRenderQueue->SetMaterial(shinyMaterial);
 
+		// Render the horse 
+		/*modelViewMatrixStack.Push();
+			modelViewMatrixStack.Translate(glm::vec3(0.0f, 0.0f, 0.0f));
+			modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), 180.0f);
+			modelViewMatrixStack.Scale(2.5f);
+			m_pHorseMesh->Submit(m_pRenderQueue, modelViewMatrixStack.Top());
+		modelViewMatrixStack.Pop();*/
 
+		if (snapshot.alive) {
+			modelViewMatrixStack.Push();
+			modelViewMatrixStack *= snapshot.spaceShip.Transform(m_interpolation);
+			modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(180.0f));
+			modelViewMatrixStack.Scale(0.02f);
+			if (frustum.IsVisible(TransformSphere(m_pCarMesh->GetBoundingSphere(), inverseViewMatrix * modelViewMatrixStack.Top())))
+				m_pCarMesh->Submit(m_pRenderQueue, modelViewMatrixStack.Top());
+			modelViewMatrixStack.Pop();
 
-	// Set light and materials in main shader program
-	pDiamondProgram->SetUniform("light1.position", viewMatrix * lightPosition1); // Position of light source *in eye coordinates*
-	pDiamondProgram->SetUniform("light1.La", glm::vec3(1.0f));		// Ambient colour of light
-	pDiamondProgram->SetUniform("light1.Ld", glm::vec3(1.0f));		// Diffuse colour of light
-	pDiamondProgram->SetUniform("light1.Ls", glm::vec3(1.0f));		// Specular colour of light
-	pDiamondProgram->SetUniform("material1.Ma", glm::vec3(1.0f));	// Ambient material reflectance
-	pDiamondProgram->SetUniform("material1.Md", glm::vec3(0.0f));	// Diffuse material reflectance
-	pDiamondProgram->SetUniform("material1.Ms", glm::vec3(0.0f));	// Specular material reflectance
-	pDiamondProgram->SetUniform("material1.shininess", 15.0f);		// Shininess material property
+			modelViewMatrixStack.Push();
+			modelViewMatrixStack *= snapshot.policeCar.Transform(m_interpolation);
+			modelViewMatrixStack.Rotate(glm::vec3(0.0f, 0.0f, 1.0f), glm::radians(90.0f));
+			modelViewMatrixStack.Rotate(glm::vec3(0.0f, 1.0f, 0.0f), glm::radians(90.0f));
+			modelViewMatrixStack.Scale(2.0f);
+			if (frustum.IsVisible(TransformSphere(m_pPoliceCarMesh->GetBoundingSphere(), inverseViewMatrix * modelViewMatrixStack.Top())))
+				m_pPoliceCarMesh->Submit(m_pRenderQueue, modelViewMatrixStack.Top());
+			modelViewMatrixStack.Pop();
 
-	pDiamondProgram->SetUniform("material1.Ma", glm::vec3(0.5f));	// Ambient material reflectance
-	pDiamondProgram->SetUniform("material1.Md", glm::vec3(0.5f));	// Diffuse material reflectance
-	pDiamondProgram->SetUniform("material1.Ms", glm::vec3(1.0f));	// Specular material reflectance
+			// All the visible rocks in one instanced draw per mesh entry
+			const float rockScale = 2.0f;
+			const BoundingSphere& rockBounds = m_pRock->GetBoundingSphere();
+			m_cullSpheres.Clear();
+			for (size_t i = 0; i < snapshot.rockPositions.size(); i++)
+				m_cullSpheres.Add(BoundingSphere(snapshot.rockPositions[i] + rockScale * rockBounds.centre, rockScale * rockBounds.radius));
+			frustum.Cull(m_cullSpheres);
+
+			InstanceData rock;
+			rock.colour = glm::vec4(1.0f);
+			rock.phase = 0.0f;
+			rock.spin = 0.0f;
+			m_instances.clear();
+			for (size_t i = 0; i < snapshot.rockPositions.size(); i++) {
+				if (!m_cullSpheres.visible[i])
+					continue;
+				rock.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), snapshot.rockPositions[i]), glm::vec3(rockScale));
+				m_instances.push_back(rock);
+			}
+			m_pRockInstances->Upload(m_instances);
+			m_pRock->SubmitInstanced(m_pRenderQueue, modelViewMatrixStack.Top());
+		}
 
-	for (int i = 0; i < 5; i++) {
-		modelViewMatrixStack.Push();
-		modelViewMatrixStack.Translate(DiamondPositions[i]);
-		modelViewMatrixStack.Scale(0.1f);
-		pDiamondProgram->SetUniform("modelViewMatrix", modelViewMatrixStack.Top());
-		pDiamondProgram->SetUniform("normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-		pDiamondProgram->SetUniform("projectionMatrix", m_pCamera->GetPerspectiveProjectionMatrix());
-		m_pDiamond->Render();
-		modelViewMatrixStack.Pop();
+		// Render the barrels, placed in Initialise
+		//if (frustum.IsVisible(m_barrelGroupBounds))
+		//	m_pBarrelMesh->SubmitInstanced(m_pRenderQueue, modelViewMatrixStack.Top());
+
+		// Render the spheres, placed in Initialise
+		if (frustum.IsVisible(m_sphereGroupBounds))
+			m_pSphere->SubmitInstanced(m_pRenderQueue, modelViewMatrixStack.Top());
+
+		// The centreline has no texture, so it is drawn with texturing turned off
+		if (frustum.IsVisible(m_pCatmullRom->GetCentrelineBounds()))
+			m_pCatmullRom->SubmitCentreline(m_pRenderQueue, modelViewMatrixStack.Top());
+		//m_pCatmullRom->RenderOffsetCurves();
+		m_pTrackStreamer->Submit(m_pRenderQueue, modelViewMatrixStack.Top(), frustum);
+
+		if (frustum.IsVisible(m_pCube->GetBoundingSphere()))
+			m_pCube->Submit(m_pRenderQueue, modelViewMatrixStack.Top());
+
+		// The diamonds are unlit; the projection comes from the frame block shared with the main program
+		// Each spins at the same rate, from a starting angle set by where it is on the track rather than by its index,
+		// which changes as others are collected.  It is culled by bounds that hold it at any angle.
+		m_pRenderQueue->SetProgram((*m_pShaderPrograms)[2]);
+		const float diamondScale = 0.1f;
+		BoundingSphere diamondBounds = SpinningSphere(m_pDiamond->GetBoundingSphere());
+		m_cullSpheres.Clear();
+		for (size_t i = 0; i < snapshot.diamondPositions.size(); i++)
+			m_cullSpheres.Add(BoundingSphere(snapshot.diamondPositions[i] + diamondScale * diamondBounds.centre, diamondScale * diamondBounds.radius));
+		frustum.Cull(m_cullSpheres);
+
+		InstanceData diamond;
+		diamond.colour = glm::vec4(1.0f);
+		diamond.spin = 2.0f;
+		m_instances.clear();
+		for (size_t i = 0; i < snapshot.diamondPositions.size(); i++) {
+			if (!m_cullSpheres.visible[i])
+				continue;
+			diamond.modelMatrix = glm::scale(glm::translate(glm::mat4(1.0f), snapshot.diamondPositions[i]), glm::vec3(diamondScale));
+			diamond.phase = snapshot.diamondDistances[i] * DIAMOND_PHASE_PER_UNIT;
+			m_instances.push_back(diamond);
+		}
+		m_pDiamondInstances->Upload(m_instances);
+		m_pDiamond->SubmitInstanced(m_pRenderQueue, modelViewMatrixStack.Top());
 	}
-	
-	pMainProgram->UseProgram();
-	// Render the barrel 
-	/*modelViewMatrixStack.Push();
-		modelViewMatrixStack.Translate(glm::vec3(100.0f, 0.0f, 0.0f));
-		modelViewMatrixStack.Scale(5.0f);
-		pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-		pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-		m_pBarrelMesh->Render();
-	modelViewMatrixStack.Pop();
-
-	modelViewMatrixStack.Push();
-	modelViewMatrixStack.Translate(glm::vec3(150.0f, 0.0f, 0.0f));
-	modelViewMatrixStack.Scale(5.0f);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pBarrelMesh->Render();
-	modelViewMatrixStack.Pop();
-
-	modelViewMatrixStack.Push();
-	modelViewMatrixStack.Translate(glm::vec3(200.0f, 0.0f, 0.0f));
-	modelViewMatrixStack.Scale(5.0f);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	m_pBarrelMesh->Render();
-	modelViewMatrixStack.Pop();
-	*/
-	
 
-	// Render the sphere
-	modelViewMatrixStack.Push();
-		modelViewMatrixStack.Translate(glm::vec3(0.0f, 2.0f, 150.0f));
-		modelViewMatrixStack.Scale(2.0f);
-		pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-		pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-		// To turn off texture mapping and use the sphere colour only (currently white material), uncomment the next line
-		//pMainProgram->SetUniform("bUseTexture", false);
-		m_pSphere->Render();
-	modelViewMatrixStack.Pop();
-
-	modelViewMatrixStack.Push();
-	modelViewMatrixStack.Translate(glm::vec3(0.0f, 6.0f, 160.0f));
-	modelViewMatrixStack.Scale(2.0f * 3);
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix", m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	// To turn off texture mapping and use the sphere colour only (currently white material), uncomment the next line
-	//pMainProgram->SetUniform("bUseTexture", false);
-	m_pSphere->Render();
-	modelViewMatrixStack.Pop();
+	{
+		PROFILE_RENDER_ZONE("Scene");
 
-	
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("bUseTexture", false); // turn off texturing
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix",
-		m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	// Render your object here
-	m_pCatmullRom->RenderCentreline();
-	modelViewMatrixStack.Pop();
-
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("bUseTexture", false); // turn off texturing
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix",
-		m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	// Render your object here
-	//m_pCatmullRom->RenderOffsetCurves();
-	modelViewMatrixStack.Pop();
-
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("bUseTexture", true); // turn off texturing
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix",
-		m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	// Render your object here
-	m_pCatmullRom->RenderPath();
-	modelViewMatrixStack.Pop();
-
-	modelViewMatrixStack.Push();
-	pMainProgram->SetUniform("bUseTexture", true); // turn off texturing
-	pMainProgram->SetUniform("matrices.modelViewMatrix", modelViewMatrixStack.Top());
-	pMainProgram->SetUniform("matrices.normalMatrix",
-		m_pCamera->ComputeNormalMatrix(modelViewMatrixStack.Top()));
-	// Render your object here
-	m_pCube->Render();
-	modelViewMatrixStack.Pop();
+		m_pRenderQueue->Sort();
+		m_pRenderQueue->Execute(m_pUniformBuffers);
+	}
 		
 	// Draw the 2D graphics after the 3D graphics
 	DisplayFrameRate();
 
-	// Swap buffers to show the rendered image
-	SwapBuffers(m_gameWindow.Hdc());		
+	m_pUniformBuffers->EndFrame();
+
+	// Swap buffers to show the rendered image, or finish the offscreen frame when running headless
+	m_pPlatform->Present();
 
 }
 
 // Update method runs repeatedly with the Render method
 void Game::Update() 
 {
-	// Update the camera using the amount of time that has elapsed to avoid framerate dependent motion
-	m_pCamera->Update(m_dt);
-	m_score += m_dt;
+	PROFILE_ZONE("Update");
+
+	// Update the camera using the amount of time that has elapsed to avoid framerate dependent motion.
+	// There is no mouse or keyboard when running headless.
+	if (m_pPlatform->HasInput())
+		m_pCamera->Update(m_dt);
+
+	// Without a simulation thread, step the simulation here
+	double now = m_pClock->Elapsed();
+	if (!m_simulationRunning)
+		AdvanceSimulation(m_dt, now);
+
+	// Take the latest snapshot, and render between its two states according to how long ago it was taken
+	m_snapshots.Consume();
+	const FrameSnapshot& snapshot = m_snapshots.Front();
+	m_interpolation = (float)glm::clamp((now - snapshot.time) / SIMULATION_STEP, 0.0, 1.0);
+
+	// Render the followed camera between its last two states
+	if (snapshot.alive && snapshot.tick > 0) {
+		float alpha = m_interpolation;
+		m_pCamera->Set(glm::mix(snapshot.cameraPosition[0], snapshot.cameraPosition[1], alpha),
+			glm::mix(snapshot.cameraView[0], snapshot.cameraView[1], alpha),
+			glm::normalize(glm::mix(snapshot.cameraUp[0], snapshot.cameraUp[1], alpha)));
+	}
+
+	m_pTrackStreamer->Update(snapshot.cameraDistance);
+
+	m_pAudio->Update();
+}
+
+// Run as many fixed steps as frameTime (in milliseconds) covers, carrying the remainder over to the next call, and
+// publish the resulting state.  now is the clock time at the end of frameTime.
+void Game::AdvanceSimulation(double frameTime, double now)
+{
+	m_simulationTime += frameTime;
+	int numSteps = 0;
+	while (m_simulationTime >= SIMULATION_STEP && numSteps < MAX_SIMULATION_STEPS_PER_FRAME) {
+		m_pEntityStore->SavePreviousState();
+		m_cameraPosition[0] = m_cameraPosition[1];
+		m_cameraView[0] = m_cameraView[1];
+		m_cameraUp[0] = m_cameraUp[1];
+		UpdateSimulation(SIMULATION_STEP);
+		m_simulationTime -= SIMULATION_STEP;
+		numSteps++;
+	}
+	if (numSteps == MAX_SIMULATION_STEPS_PER_FRAME)
+		m_simulationTime = fmod(m_simulationTime, SIMULATION_STEP);
+
+	// The simulation has reached the time the remainder was left over from
+	if (numSteps > 0)
+		PublishSnapshot(now - m_simulationTime);
+}
+
+// Copy what Render needs out of the simulation state into the back buffer of the mailbox, and hand it over
+void Game::PublishSnapshot(double time)
+{
+	PROFILE_ZONE("PublishSnapshot");
+
+	FrameSnapshot& snapshot = m_snapshots.Back();
+	snapshot.time = time;
+	snapshot.tick = m_simulationTicks;
+	snapshot.alive = m_bAlive != 0.0f;
+	snapshot.score = m_score;
+	snapshot.cameraDistance = m_currentDistance;
+	for (int i = 0; i < 2; i++) {
+		snapshot.cameraPosition[i] = m_cameraPosition[i];
+		snapshot.cameraView[i] = m_cameraView[i];
+		snapshot.cameraUp[i] = m_cameraUp[i];
+	}
+
+	VehicleSnapshot spaceShip = { m_pEntityStore->PreviousPosition(m_spaceShip), m_pEntityStore->Position(m_spaceShip),
+		m_pEntityStore->PreviousOrientation(m_spaceShip), m_pEntityStore->Orientation(m_spaceShip) };
+	VehicleSnapshot policeCar = { m_pEntityStore->PreviousPosition(m_policeCar), m_pEntityStore->Position(m_policeCar),
+		m_pEntityStore->PreviousOrientation(m_policeCar), m_pEntityStore->Orientation(m_policeCar) };
+	snapshot.spaceShip = spaceShip;
+	snapshot.policeCar = policeCar;
+
+	// Assignment reuses the buffer's storage, so this only allocates while the snapshots warm up
+	snapshot.rockPositions = m_pEntityStore->Archetype(ENTITY_ROCK).positions;
+	snapshot.diamondPositions = m_pEntityStore->Archetype(ENTITY_DIAMOND).positions;
+	snapshot.diamondDistances = m_pEntityStore->Archetype(ENTITY_DIAMOND).distances;
+
+	m_snapshots.Publish();
+}
+
+// From here until StopSimulationThread, the simulation runs on its own thread, and Update only consumes its snapshots
+void Game::StartSimulationThread()
+{
+	m_simulationRunning = true;
+	m_simulationThread = thread(&Game::SimulationThread, this);
+}
+
+void Game::StopSimulationThread()
+{
+	m_simulationRunning = false;
+	if (m_simulationThread.joinable())
+		m_simulationThread.join();
+}
+
+// The simulation thread steps the simulation in real time, sleeping between steps rather than spinning.  It pauses
+// while the application is inactive, and does not count the time it was paused.
+void Game::SimulationThread()
+{
+	double lastTime = m_pClock->Elapsed();
+	while (m_simulationRunning) {
+		double now = m_pClock->Elapsed();
+		if (!m_appActive) {
+			lastTime = now;
+			this_thread::sleep_for(chrono::milliseconds(200));
+			continue;
+		}
+
+		{
+			PROFILE_ZONE("Simulation");
+			AdvanceSimulation(now - lastTime, now);
+		}
+		lastTime = now;
+
+		// Wait until the next step is due.  Sleep may overshoot, in which case the next pass catches up.
+		double wait = SIMULATION_STEP - m_simulationTime;
+		if (wait >= 1.0)
+			this_thread::sleep_for(chrono::microseconds((long long)(wait * 1000.0)));
+		else
+			this_thread::yield();
+	}
+}
+
+// Advance the simulation by dt milliseconds
+void Game::UpdateSimulation(double dt)
+{
+	PROFILE_ZONE("UpdateSimulation");
+
+	m_score += dt;
 	
 	static float t = 0.0f;
-	t += 0.0003f * (float)m_dt;
+	t += 0.0003f * (float)dt;
 	if (t > 1.0f)
 		t = 0.0f;
 
-	m_currentDistance += m_dt * m_Speed;
-	glm::vec3 p;
-	glm::vec3 pNext;
-	m_pCatmullRom->Sample(m_currentDistance, p);
-	m_pCatmullRom->Sample(m_currentDistance +1.0f, pNext);
-	if(m_bCam)
-		m_pCatmullRom->Sample(m_currentDistance - 1.0f, pNext);
-	glm::vec3 T = glm::normalize(pNext - p);
-	glm::vec3 y(0, 1, 0);
-	glm::vec3 N = glm::normalize(glm::cross(T, y));
-	glm::vec3 B = glm::normalize(glm::cross(N, T));
-
-	//-------------------------------------------
-	m_currentDistance1 += m_dt * m_Speed;
-	glm::vec3 p1;
-	glm::vec3 pNext1;
-	m_pCatmullRom->Sample(m_currentDistance1, p1);
-	m_pCatmullRom->Sample(m_currentDistance1 + 1.0f, pNext1);
-	glm::vec3 T1 = glm::normalize(pNext1 - p1);
-	glm::vec3 y1(0, 1, 0);
-	glm::vec3 N1 = glm::normalize(glm::cross(T1, y1));
-	glm::vec3 B1 = glm::normalize(glm::cross(N1, T1));
-	//-------------------------------------------------------------------------------------
-	
-	m_currentDistance2 += m_dt * m_multiplier;
-	glm::vec3 p2;
-	glm::vec3 pNext2;
-	m_pCatmullRom->Sample(m_currentDistance2, p2);
-	m_pCatmullRom->Sample(m_currentDistance2 + 1.0f, pNext2);
-	glm::vec3 T2 = glm::normalize(pNext2 - p2);
-	glm::vec3 y2(0, 1, 0);
-	glm::vec3 N2 = glm::normalize(glm::cross(T2, y2));
-	glm::vec3 B2 = glm::normalize(glm::cross(N2, T2));
-
-
-	glm::vec3 offSetPosition = p1 + (m_offSet * N1);
-	m_spaceShipPosition = offSetPosition;
-	//m_spaceShipPosition = p1;
-	//m_spaceShipPosition = p + 20.0f * T;
-	m_spaceShipOrientation = glm::mat4(glm::mat3(T1, B1, N1));
-
-	glm::vec3 offSetPosition2 = p2 + (m_offSet * N2);
-	m_PoliceCarPosition = offSetPosition2;
-	m_PoliceCarOrientation = glm::mat4(glm::mat3(T2, B2, N2));
+	// One frame-table lookup per follower gives the position and orientation
+	m_currentDistance += dt * m_Speed;
+	CurveFrame frame;
+	m_pCatmullRom->SampleFrame(m_currentDistance, frame);
+	glm::vec3 p = frame.position;
+	glm::vec3 T = m_bCam ? -frame.Tangent() : frame.Tangent();	// The reversing camera looks back along the track
+	glm::vec3 B = frame.Up();
+
+	// The spaceship keeps pace with the camera, while the police car slowly speeds up.  Both follow the player's offset.
+	m_pEntityStore->Distance(m_spaceShip) += dt * m_Speed;
+	m_pEntityStore->Distance(m_policeCar) += dt * m_multiplier;
+	m_pEntityStore->LateralOffset(m_spaceShip) = m_offSet;
+	m_pEntityStore->LateralOffset(m_policeCar) = m_offSet;
 	m_multiplier += 0.000001f;
+
+	EntityArchetype& vehicles = m_pEntityStore->Archetype(ENTITY_VEHICLE);
+	for (int i = 0; i < vehicles.Count(); i++) {
+		CurveFrame vehicleFrame;
+		m_pCatmullRom->SampleFrame(vehicles.distances[i], vehicleFrame);
+		vehicles.positions[i] = vehicleFrame.position + vehicles.lateralOffsets[i] * vehicleFrame.Side();
+		vehicles.orientations[i] = vehicleFrame.orientation;
+	}
 	//----------------------------------------------------------------------------
-	glm::vec3 up = glm::normalize(glm::rotate(glm::vec3(0, 1, 0), m_cameraRotation, T));
+	glm::vec3 up = glm::normalize(glm::rotate(B, m_cameraRotation, T));
 
 	p.y = 8.0f;
 
 	glm::vec3 viewPoint = p + 10.0f * T;
-	if(m_bAlive)
-	m_pCamera->Set(p, viewPoint, up);
-
-	if (glm::distance(m_PoliceCarPosition, m_spaceShipPosition) <= 12.0f) {
-		m_bAlive = false;
+	if (m_bAlive) {
+		m_cameraPosition[1] = p;
+		m_cameraView[1] = viewPoint;
+		m_cameraUp[1] = up;
 	}
-	
-	for (int i = 0; i < 6; i++) {
-		if (glm::length(RockPositions[i] - m_spaceShipPosition) < 6.0f) {
-			m_Speed = m_Speed*0.95;
-			RockPositions[i] = glm::vec3(0.0f, 0.0f, 0.0f); //try to store objects themselves in vectors rather than just the positions
-			break;
-		}
+
+	// The first step has nothing before it to interpolate from
+	if (m_simulationTicks++ == 0) {
+		m_pEntityStore->SavePreviousState();
+		m_cameraPosition[0] = m_cameraPosition[1];
+		m_cameraView[0] = m_cameraView[1];
+		m_cameraUp[0] = m_cameraUp[1];
 	}
-	
-	for (int i = 0; i < 6; i++) {
-		if (glm::length(DiamondPositions[i] - m_spaceShipPosition) < 4.0f) {
-			m_Speed = m_Speed * 1.10;
-			DiamondPositions[i] = glm::vec3(0.0f, 0.0f, 0.0f); //try to store objects themselves in vectors rather than just the positions
-			break;
-		}
+
+	// Only the entities near the spaceship along the track are tested against it
+	m_pBroadphase->UpdateVehicles(*m_pEntityStore);
+	glm::vec3 spaceShipPosition = m_pEntityStore->Position(m_spaceShip);
+	m_collisionCandidates.clear();
+	m_pBroadphase->Query(ENTITY_VEHICLE, m_pEntityStore->Distance(m_spaceShip), 2.0f * 12.0f, *m_pEntityStore,
+		m_collisionCandidates);
+	for (size_t i = 0; i < m_collisionCandidates.size(); i++) {
+		if (m_collisionCandidates[i] == m_policeCar &&
+			glm::distance(m_pEntityStore->Position(m_policeCar), spaceShipPosition) <= 12.0f)
+			m_bAlive = false;
 	}
 
+	for (int i = CollectPickups(ENTITY_ROCK, 6.0f); i > 0; i--)
+		m_Speed = m_Speed * 0.95;
+	for (int i = CollectPickups(ENTITY_DIAMOND, 4.0f); i > 0; i--)
+		m_Speed = m_Speed * 1.10;
+
 	//glm::vec3 point = m_pCatmullRom->pointOnCircle(radius,t, center);
 	//m_pCatmullRom->angle = m_pCatmullRom->angle + 0.01;
 	//if (m_pCatmullRom->angle > 360)
@@ -587,8 +796,29 @@ void Game::Update()
 	
 	//glm::vec3 p = m_pCatmullRom->Interpolate(p0, p1, p2, p3, t);
 	//m_pCamera->Set(glm::vec3 (point.x,50,point.z), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+}
 
-	m_pAudio->Update();
+// Remove every pickup of a kind within radius of the spaceship, and return how many there were.  The broadphase
+// window is twice the radius:  distances along the centreline are longer than the straight-line distance between
+// entities on the inside of a corner, but by less than a factor of two where the corner radius is more than the
+// track width.
+int Game::CollectPickups(EntityKind kind, float radius)
+{
+	glm::vec3 spaceShipPosition = m_pEntityStore->Position(m_spaceShip);
+	m_collisionCandidates.clear();
+	m_pBroadphase->Query(kind, m_pEntityStore->Distance(m_spaceShip), 2.0f * radius, *m_pEntityStore,
+		m_collisionCandidates);
+
+	int numCollected = 0;
+	for (size_t i = 0; i < m_collisionCandidates.size(); i++) {
+		if (glm::length(m_pEntityStore->Position(m_collisionCandidates[i]) - spaceShipPosition) < radius) {
+			m_pEntityStore->Destroy(m_collisionCandidates[i]);
+			numCollected++;
+		}
+	}
+	if (numCollected > 0)
+		m_pBroadphase->RemoveStale(*m_pEntityStore, kind);
+	return numCollected;
 }
 
 
@@ -596,15 +826,14 @@ void Game::Update()
 
 void Game::DisplayFrameRate()
 {
-
+	PROFILE_RENDER_ZONE("HUD");
 
 	CShaderProgram *fontProgram = (*m_pShaderPrograms)[1];
 
-	RECT dimensions = m_gameWindow.GetDimensions();
-	int height = dimensions.bottom - dimensions.top;
+	int height = m_pPlatform->GetHeight();
 
 	// Increase the elapsed time and frame counter
-	m_elapsedTime += (m_dt*m_scoreMultiplier);
+	m_elapsedTime += m_dt;
 	m_frameCount++;
 
 	// Now we want to subtract the current time by the last time that was stored
@@ -637,52 +866,68 @@ void Game::DisplayFrameRate()
 	fontProgram->SetUniform("matrices.modelViewMatrix", glm::mat4(1));
 	fontProgram->SetUniform("matrices.projMatrix", m_pCamera->GetOrthographicProjectionMatrix());
 	fontProgram->SetUniform("vColour", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
-	m_pFtFont->Render(300, height - 40, 20, "Score %f", m_score);
+	const FrameSnapshot& snapshot = m_snapshots.Front();
+	m_pFtFont->Render(300, height - 40, 20, "Score %f", snapshot.score);
 
 
-	if (!m_bAlive) {
+	if (!snapshot.alive) {
 		glDisable(GL_DEPTH_TEST);
 		fontProgram->SetUniform("matrices.modelViewMatrix", glm::mat4(1));
 		fontProgram->SetUniform("matrices.projMatrix", m_pCamera->GetOrthographicProjectionMatrix());
 		fontProgram->SetUniform("vColour", glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
 		m_pFtFont->Render(200, height - 200, 50, "GAME OVER !", NULL);
 	}
+
+#if PROFILER_ENABLED
+	// Per-zone CPU and GPU times, toggled with F2
+	if (m_bShowProfiler) {
+		fontProgram->SetUniform("vColour", glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+		CProfiler::GetInstance().RenderOverlay(m_pFtFont, 20, height - 70, 16);
+	}
+#endif
 }
 
 // The game loop runs repeatedly until game over
 void Game::GameLoop()
 {
-	/*
-	// Fixed timer
-	dDt = pHighResolutionTimer->Elapsed();
-	if (dDt > 1000.0 / (double) Game::FPS) {
-		pHighResolutionTimer->Start();
+	// Variable frame time.  The simulation runs in fixed steps on its own thread, or in Update to match the frame time.
+	m_pHighResolutionTimer->Start();
+	{
+		PROFILE_ZONE("Frame");
 		Update();
 		Render();
 	}
-	*/
-	
-	
-	// Variable timer
-	m_pHighResolutionTimer->Start();
-	Update();
-	Render();
 	m_dt = m_pHighResolutionTimer->Elapsed();
-	
+	PROFILE_END_FRAME();
 
 }
 
 
+// Create the track, from m_trackFilename if one was given.  If that file cannot be loaded the run stops, rather than
+// quietly playing (or measuring) the built-in track instead.
+bool Game::LoadTrack()
+{
+	m_pCatmullRom = new CCatmullRom;
+	return m_trackFilename.empty() || m_pCatmullRom->LoadTrack(m_trackFilename);
+}
+
 WPARAM Game::Execute() 
 {
 	m_pHighResolutionTimer = new CHighResolutionTimer;
+	m_pClock = new CHighResolutionTimer;
+	m_pClock->Start();
+	if (!LoadTrack())
+		return 1;
 	m_gameWindow.Init(m_hInstance);
 
 	if(!m_gameWindow.Hdc()) {
 		return 1;
 	}
+	m_pPlatform = &m_gameWindow;
 
 	Initialise();
+	if (m_bThreadedSimulation)
+		StartSimulationThread();
 
 	m_pHighResolutionTimer->Start();
 
@@ -703,11 +948,79 @@ WPARAM Game::Execute()
 		else Sleep(200); // Do not consume processor power if application isn't active
 	}
 
+	StopSimulationThread();
+	CProfiler::GetInstance().Release();
 	m_gameWindow.Deinit();
 
 	return(msg.wParam);
 }
 
+// Run the game loop for a fixed number of frames with no window, rendering into an offscreen framebuffer.
+// The frame time statistics are written to stdout so they can be tracked on build machines, and the profile of the
+// last frames is written to traceFilename (chrome://tracing format) if one is given.
+int Game::ExecuteHeadless(int numFrames, string traceFilename)
+{
+	m_pHighResolutionTimer = new CHighResolutionTimer;
+	m_pClock = new CHighResolutionTimer;
+	m_pClock->Start();
+	if (!LoadTrack())
+		return 1;
+	m_pHeadlessContext = new CHeadlessContext;
+	if (!m_pHeadlessContext->Create(GameWindow::SCREEN_WIDTH, GameWindow::SCREEN_HEIGHT))
+		return 1;
+	m_pPlatform = m_pHeadlessContext;
+
+	Initialise();
+	m_appActive = true;
+	if (m_bThreadedSimulation)
+		StartSimulationThread();
+
+	double totalTime = 0.0, minTime = 1e30, maxTime = 0.0;
+	for (int i = 0; i < numFrames; i++) {
+		GameLoop();
+		totalTime += m_dt;
+		minTime = min(minTime, m_dt);
+		maxTime = max(maxTime, m_dt);
+	}
+
+	if (numFrames > 0)
+		printf("headless: %d frames, %.3f ms/frame (min %.3f, max %.3f)\n", numFrames, totalTime / numFrames, minTime, maxTime);
+	StopSimulationThread();
+
+	if (!traceFilename.empty() && !CProfiler::GetInstance().ExportChromeTrace(traceFilename))
+		fprintf(stderr, "Cannot write profile trace to %s\n", traceFilename.c_str());
+
+	CProfiler::GetInstance().Release();
+	m_pHeadlessContext->Release();
+	return 0;
+}
+
+// Run only the simulation for a fixed number of ticks with a fixed time step (in milliseconds), as fast as possible.
+// No OpenGL context, window or audio is created, and nothing is rendered.  Reports the simulation throughput on stdout.
+int Game::ExecuteSimulation(int numTicks, double dt)
+{
+	m_pHighResolutionTimer = new CHighResolutionTimer;
+	m_pCamera = new CCamera;
+	if (!LoadTrack())
+		return 1;
+	m_pCatmullRom->ComputeCentreline();
+	m_pCatmullRom->ComputeOffsetCurves();
+	m_pEntityStore = new CEntityStore;
+	m_pBroadphase = new CTrackBroadphase;
+	CreateEntities();
+
+	m_pHighResolutionTimer->Start();
+	for (int i = 0; i < numTicks; i++)
+		UpdateSimulation(dt);
+	double elapsed = m_pHighResolutionTimer->Elapsed();
+
+	if (numTicks > 0 && elapsed > 0.0)
+		printf("simulate: %d ticks in %.3f ms, %.0f ticks/s (score %.1f, %s)\n", numTicks, elapsed,
+			numTicks * 1000.0 / elapsed, m_score, m_bAlive ? "alive" : "caught");
+
+	return 0;
+}
+
 LRESULT Game::ProcessEvents(HWND window,UINT message, WPARAM w_param, LPARAM l_param) 
 {
 	LRESULT result = 0;
@@ -757,17 +1070,25 @@ LRESULT Game::ProcessEvents(HWND window,UINT message, WPARAM w_param, LPARAM l_p
 		case VK_LEFT:
 			//m_cameraRotation -= m_dt * 0.005f;
 			if (m_offSet > -10.0f) {
-				m_offSet -= m_dt * 0.08f;
+				m_offSet = m_offSet - (float)m_dt * 0.08f;
 			}
 			break;
 		case VK_RIGHT:
 			//m_cameraRotation += m_dt * 0.005f;
 			if (m_offSet < 10.0f) {
-				m_offSet += m_dt * 0.08f;
+				m_offSet = m_offSet + (float)m_dt * 0.08f;
 			}
 			break;
 		case VK_CAPITAL:
 			m_bCam = !m_bCam;
+			break;
+		case VK_F2:
+			m_bShowProfiler = !m_bShowProfiler;
+			break;
+		case VK_F3:
+			if (!CProfiler::GetInstance().ExportChromeTrace("profile.json"))
+				MessageBox(NULL, "Cannot write profile.json", "Error", MB_ICONERROR);
+			break;
 		}
 		break;
 
@@ -795,15 +1116,147 @@ void Game::SetHinstance(HINSTANCE hinstance)
 	m_hInstance = hinstance;
 }
 
+void Game::SetTrackFilename(string filename)
+{
+	m_trackFilename = filename;
+}
+
+void Game::SetPickups(int numRocks, int numDiamonds, unsigned long long seed)
+{
+	m_numRocks = max(numRocks, 0);
+	m_numDiamonds = max(numDiamonds, 0);
+	m_pickupSeed = seed;
+}
+
+void Game::SetThreadedSimulation(bool threaded)
+{
+	m_bThreadedSimulation = threaded;
+}
+
 LRESULT CALLBACK WinProc(HWND window, UINT message, WPARAM w_param, LPARAM l_param)
 {
 	return Game::GetInstance().ProcessEvents(window, message, w_param, l_param);
 }
 
-int WINAPI WinMain(HINSTANCE hinstance, HINSTANCE, PSTR, int) 
+// Send printf output to the console that launched the program, if there is one.  Console runs are often unattended, so
+// track errors are written to stderr there too, instead of waiting on a message box.
+static void AttachParentConsole()
+{
+	CTrackFile::SetConsoleErrors(true);
+	if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+		FILE* fp;
+		freopen_s(&fp, "CONOUT$", "w", stdout);
+		freopen_s(&fp, "CONOUT$", "w", stderr);
+	}
+}
+
+// Read the next command line argument into arg, unless there are none left or the next one is an option (starting
+// with -), so that an optional argument left out does not swallow the option after it
+static bool ReadArgument(stringstream& args, string& arg)
+{
+	streampos position = args.tellg();
+	string next;
+	if (!(args >> next) || next[0] == '-') {
+		args.clear();
+		args.seekg(position);
+		return false;
+	}
+	arg = next;
+	return true;
+}
+
+int WINAPI WinMain(HINSTANCE hinstance, HINSTANCE, PSTR cmdLine, int) 
 {
 	Game &game = Game::GetInstance();
 	game.SetHinstance(hinstance);
 
+	// -headless [frames] [trace.json] renders offscreen with no window, reports the frame time and optionally saves a profile
+	// -simulate [ticks] [dt] runs only the simulation, with a fixed time step in milliseconds, and reports ticks per second
+	// -bench [options] runs the microbenchmarks (see CBenchmark::Run for the options)
+	// -track <file> plays on a track loaded from a .trk or text file (see TrackFile.h)
+	// -convert-track <in> <out.trk> [-arc] converts a track to binary, optionally with its arc length table
+	// -pickups <rocks> <diamonds> [seed] sets how many pickups are placed, and the seed that places them
+	// -single-thread runs the simulation in the game loop instead of on its own thread
+	// -isa <scalar|sse|avx> keeps the SIMD kernels to the given instruction set, to compare them
+	// Options may come before or after -headless and -simulate.  -convert-track and -bench start straight away, so they
+	// come last.
+	stringstream args(cmdLine);
+	string arg;
+	bool headless = false, simulate = false;
+	int numFrames = 1000, numTicks = 1000000;
+	string traceFilename;
+	double dt = Game::SIMULATION_STEP;
+	while (args >> arg) {
+		if (arg == "-headless") {
+			headless = true;
+			if (ReadArgument(args, arg))
+				numFrames = atoi(arg.c_str());
+			if (ReadArgument(args, arg))
+				traceFilename = arg;
+			continue;
+		}
+		if (arg == "-simulate") {
+			simulate = true;
+			if (ReadArgument(args, arg))
+				numTicks = atoi(arg.c_str());
+			if (ReadArgument(args, arg))
+				dt = atof(arg.c_str());
+			continue;
+		}
+		if (arg == "-track") {
+			if (ReadArgument(args, arg))
+				game.SetTrackFilename(arg);
+			continue;
+		}
+		if (arg == "-pickups") {
+			int numRocks = 7, numDiamonds = 5;
+			unsigned long long seed = 1;
+			if (ReadArgument(args, arg))
+				numRocks = atoi(arg.c_str());
+			if (ReadArgument(args, arg))
+				numDiamonds = atoi(arg.c_str());
+			if (ReadArgument(args, arg))
+				seed = strtoull(arg.c_str(), NULL, 10);
+			game.SetPickups(numRocks, numDiamonds, seed);
+			continue;
+		}
+		if (arg == "-isa") {
+			InstructionSet instructionSet;
+			if (ReadArgument(args, arg) && ParseInstructionSet(arg.c_str(), instructionSet))
+				LimitInstructionSet(instructionSet);
+			continue;
+		}
+		if (arg == "-single-thread") {
+			game.SetThreadedSimulation(false);
+			continue;
+		}
+		if (arg == "-convert-track") {
+			string inFilename, outFilename;
+			args >> inFilename >> outFilename;
+			bool includeArcLengths = (args >> arg) && arg == "-arc";
+			AttachParentConsole();
+			CCatmullRom track;
+			if (!track.LoadTrack(inFilename))
+				return 1;
+			track.ComputeCentreline();
+			if (!track.SaveTrack(outFilename, includeArcLengths))
+				return 1;
+			printf("convert-track: wrote %s\n", outFilename.c_str());
+			return 0;
+		}
+		if (arg == "-bench") {
+			vector<string> benchmarkArgs;
+			while (args >> arg)
+				benchmarkArgs.push_back(arg);
+			AttachParentConsole();
+			CBenchmark benchmark;
+			return benchmark.Run(benchmarkArgs);
+		}
+	}
+
+	if (headless || simulate) {
+		AttachParentConsole();
+		return headless ? game.ExecuteHeadless(numFrames, traceFilename) : game.ExecuteSimulation(numTicks, dt);
+	}
 	return int(game.Execute());
 }
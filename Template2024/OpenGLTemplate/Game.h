@@ -2,6 +2,15 @@
 
 #include "Common.h"
 #include "GameWindow.h"
+#include "EntityStore.h"
+#include "FrameSnapshot.h"
+#include "TripleBuffer.h"
+#include "Shaders.h"
+#include "InstanceBuffer.h"
+#include "Frustum.h"
+
+#include <atomic>
+#include <thread>
 
 // Classes used in game.  For a new class, declare it here and provide a pointer to an object of this class below.  Then, in Game.cpp, 
 // include the header.  In the Game constructor, set the pointer to NULL and in Game::Initialise, create a new object.  Don't forget to 
@@ -18,15 +27,34 @@ class CSphere;
 class COpenAssetImportMesh;
 class CAudio;
 class CCatmullRom;
+class CTrackStreamer;
+class CTrackBroadphase;
 class CCube;
+class CHeadlessContext;
+class CUniformBuffers;
+class CRenderQueue;
 
 class Game {
 private:
 	// Three main methods used in the game.  Initialise runs once, while Update and Render run repeatedly in the game loop.
 	void Initialise();
+	bool LoadTrack();
 	void Update();
 	void Render();
 
+	// The simulation part of Update:  vehicles following the track, pickups and the police chase.  It needs no
+	// OpenGL context, input or audio, so it can be run on its own in simulation mode.  Update steps it by
+	// SIMULATION_STEP milliseconds at a time, so it behaves the same at any frame rate.
+	void UpdateSimulation(double dt);
+	void AdvanceSimulation(double frameTime, double now);	// Fixed steps covering frameTime, then a snapshot
+	void PublishSnapshot(double now);
+	void StartSimulationThread();
+	void StopSimulationThread();
+	void SimulationThread();
+	void CreateEntities();
+	void PlacePickups();
+	int CollectPickups(EntityKind kind, float radius);
+
 	// Pointers to game objects.  They will get allocated in Game::Initialise()
 	CSkybox *m_pSkybox;
 	CCamera *m_pCamera;
@@ -42,47 +70,85 @@ private:
 	CHighResolutionTimer *m_pHighResolutionTimer;
 	CAudio *m_pAudio;
 	CCatmullRom* m_pCatmullRom;
+	CTrackStreamer* m_pTrackStreamer;	// Streams the track mesh around the camera
+	CEntityStore* m_pEntityStore;		// Pickups and vehicles
+	CTrackBroadphase* m_pBroadphase;	// Finds the entities near a distance along the track
 	CDiamond* m_pDiamond;
 	CCube* m_pCube;
+	CHeadlessContext* m_pHeadlessContext;	// Only created when running headless
+	CPlatformContext* m_pPlatform;			// What the game renders through:  the window, or the headless context
+
+	CUniformBuffers* m_pUniformBuffers;	// Frame, material and object uniform blocks shared by the shader programs
+	UniformHandle<int> m_useTextureUniform;	// Looked up once the main program is linked
+	CRenderQueue* m_pRenderQueue;		// The frame's draws, sorted by the state they need
+	CInstanceBuffer* m_pRockInstances;	// Repeated meshes are drawn instanced from these
+	CInstanceBuffer* m_pDiamondInstances;
+	CInstanceBuffer* m_pSphereInstances;
+	CInstanceBuffer* m_pBarrelInstances;
+	vector<InstanceData> m_instances;	// Scratch space for filling the instance buffers
+	SphereList m_cullSpheres;			// Scratch space for culling the rocks and diamonds
+	BoundingSphere m_sphereGroupBounds;	// Around all the spheres and barrels placed in Initialise
+	BoundingSphere m_barrelGroupBounds;
 
 
 	// Some other member variables
 	double m_dt;
 	int m_framesPerSecond;
-	bool m_appActive;
+	atomic<bool> m_appActive;
 	float m_currentDistance;
-	float m_currentDistance1;
-	float m_currentDistance2;
 	float m_multiplier;
-	bool m_bCam;
+	atomic<bool> m_bCam;
 	float m_cameraRotation;
 	float m_t;
-	float m_offSet;
+	atomic<float> m_offSet;			// Set from input on the main thread, read by the simulation
 	float m_Speed;
 	float m_bAlive;
 	double m_score;
 	double m_topScore;
 	double m_scoreMultiplier;
-	glm::vec3 m_RockPos;
-	glm::vec3 m_spaceShipPosition;
-	glm::vec3 m_PoliceCarPosition;
-	glm::mat4 m_PoliceCarOrientation;
-	glm::mat4 m_spaceShipOrientation;
-	std::vector<glm::vec3> RockPositions;
-	std::vector<glm::vec3> DiamondPositions;
+	bool m_bShowProfiler;
+	string m_trackFilename;			// Track to load, or empty for the built-in track
+	int m_numRocks;
+	int m_numDiamonds;
+	unsigned long long m_pickupSeed;	// The same seed always places the pickups in the same places
+	EntityHandle m_spaceShip;
+	EntityHandle m_policeCar;
+	vector<EntityHandle> m_collisionCandidates;	// Scratch space for broadphase queries
+	double m_simulationTime;		// Frame time not yet simulated, in milliseconds
+	int m_simulationTicks;
+	float m_interpolation;			// Fraction of a step from the previous simulation state to the current one
+	glm::vec3 m_cameraPosition[2];	// Followed camera before and after the last step, for rendering between them
+	glm::vec3 m_cameraView[2];
+	glm::vec3 m_cameraUp[2];
+
+	// Once the simulation thread is running, it owns the simulation state above (the entity store, broadphase, score
+	// and so on), and Update and Render only read the snapshots it publishes
+	CHighResolutionTimer* m_pClock;	// Started once; snapshot times are measured from it
+	CTripleBuffer<FrameSnapshot> m_snapshots;
+	thread m_simulationThread;
+	atomic<bool> m_simulationRunning;
+	bool m_bThreadedSimulation;
 
 
 
 public:
+	static const double SIMULATION_STEP;		// Milliseconds per simulation step (120 Hz)
+
 	Game();
 	~Game();
 	static Game& GetInstance();
 	LRESULT ProcessEvents(HWND window,UINT message, WPARAM w_param, LPARAM l_param);
 	void SetHinstance(HINSTANCE hinstance);
+	void SetTrackFilename(string filename);
+	void SetPickups(int numRocks, int numDiamonds, unsigned long long seed);
+	void SetThreadedSimulation(bool threaded);
 	WPARAM Execute();
+	int ExecuteHeadless(int numFrames, string traceFilename);
+	int ExecuteSimulation(int numTicks, double dt);
 
 private:
 	static const int FPS = 60;
+	static const int MAX_SIMULATION_STEPS_PER_FRAME = 8;	// Below 15 fps the game slows down rather than falling behind
 	void DisplayFrameRate();
 	void GameLoop();
 	GameWindow m_gameWindow;
@@ -292,4 +292,25 @@ void GameWindow::Deinit()
 
 	UnregisterClass(m_class, m_hinstance);
 	PostQuitMessage(0);
+}
+
+int GameWindow::GetWidth()
+{
+	return m_dimensions.right - m_dimensions.left;
+}
+
+int GameWindow::GetHeight()
+{
+	return m_dimensions.bottom - m_dimensions.top;
+}
+
+bool GameWindow::HasInput()
+{
+	return true;
+}
+
+// Swap buffers to show the rendered image
+void GameWindow::Present()
+{
+	SwapBuffers(m_hdc);
 }
\ No newline at end of file
@@ -2,10 +2,11 @@
 
 #include <windows.h>
 #include "Common.h"
+#include "PlatformContext.h"
 
 LRESULT CALLBACK WinProc(HWND hWnd,UINT uMsg, WPARAM wParam, LPARAM lParam);
 
-class GameWindow {
+class GameWindow : public CPlatformContext {
 public:
 	static GameWindow& GetInstance();
 	GameWindow();
@@ -23,6 +24,11 @@ public:
 
 	bool Fullscreen() const { return m_fullscreen; }
 
+	int GetWidth();
+	int GetHeight();
+	bool HasInput();
+	void Present();
+
 	HDC Hdc() const { return m_hdc; }
 	HINSTANCE Hinstance() const { return m_hinstance; }
 	HGLRC Hrc() const { return m_hrc; }
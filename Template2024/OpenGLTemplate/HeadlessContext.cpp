@@ -0,0 +1,268 @@
+#include "HeadlessContext.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include "include/gl/wglew.h"
+#define HEADLESS_OPENGL_CLASS_NAME "headless_openGL_class_name"
+#endif
+
+CHeadlessContext::CHeadlessContext()
+{
+#ifdef _WIN32
+	m_hwnd = NULL;
+	m_hdc = NULL;
+	m_hrc = NULL;
+#else
+	m_display = EGL_NO_DISPLAY;
+	m_context = EGL_NO_CONTEXT;
+#endif
+	m_fbo = 0;
+	m_colourRenderbuffer = 0;
+	m_depthRenderbuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+CHeadlessContext::~CHeadlessContext()
+{}
+
+// Create an OpenGL context with no visible window and a framebuffer of the given size to render into
+bool CHeadlessContext::Create(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	if (!CreateContext()) {
+		fprintf(stderr, "Headless: could not create an OpenGL 4.0 core context\n");
+		DestroyContext();
+		return false;
+	}
+
+	if (!CreateFramebuffer()) {
+		fprintf(stderr, "Headless: offscreen framebuffer is incomplete\n");
+		Release();
+		return false;
+	}
+
+	Bind();
+	return true;
+}
+
+#ifdef _WIN32
+
+// WGL backend:  a hidden window provides the device context.  A legacy context is needed first to initialise GLEW
+// and get wglCreateContextAttribsARB; it is then replaced with a 4.0 core context.  Nothing is ever drawn to the window.
+bool CHeadlessContext::CreateContext()
+{
+	HINSTANCE hinstance = GetModuleHandle(NULL);
+
+	WNDCLASSEX wc;
+	memset(&wc, 0, sizeof(WNDCLASSEX));
+	wc.cbSize = sizeof(WNDCLASSEX);
+	wc.style = CS_OWNDC;
+	wc.lpfnWndProc = DefWindowProc;
+	wc.hInstance = hinstance;
+	wc.lpszClassName = HEADLESS_OPENGL_CLASS_NAME;
+	RegisterClassEx(&wc);
+
+	m_hwnd = CreateWindow(HEADLESS_OPENGL_CLASS_NAME, "Headless", WS_OVERLAPPEDWINDOW, 0, 0, m_width, m_height, NULL, NULL, hinstance, NULL);
+	if (m_hwnd == NULL)
+		return false;
+	m_hdc = GetDC(m_hwnd);
+
+	PIXELFORMATDESCRIPTOR pfd;
+	memset(&pfd, 0, sizeof(PIXELFORMATDESCRIPTOR));
+	pfd.nSize = sizeof(PIXELFORMATDESCRIPTOR);
+	pfd.nVersion = 1;
+	pfd.dwFlags = PFD_SUPPORT_OPENGL | PFD_DRAW_TO_WINDOW;
+	pfd.iPixelType = PFD_TYPE_RGBA;
+	pfd.cColorBits = 32;
+	pfd.cDepthBits = 24;
+	pfd.iLayerType = PFD_MAIN_PLANE;
+
+	int iPixelFormat = ChoosePixelFormat(m_hdc, &pfd);
+	if (iPixelFormat == 0 || !SetPixelFormat(m_hdc, iPixelFormat, &pfd))
+		return false;
+
+	HGLRC hRCFake = wglCreateContext(m_hdc);
+	if (hRCFake == NULL)
+		return false;
+	wglMakeCurrent(m_hdc, hRCFake);
+
+	if (glewInit() != GLEW_OK || !WGLEW_ARB_create_context) {
+		wglMakeCurrent(NULL, NULL);
+		wglDeleteContext(hRCFake);
+		return false;
+	}
+
+	int iContextAttribs[] =
+	{
+		WGL_CONTEXT_MAJOR_VERSION_ARB, 4,
+		WGL_CONTEXT_MINOR_VERSION_ARB, 0,
+		WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+		0 // End of attributes list
+	};
+	m_hrc = wglCreateContextAttribsARB(m_hdc, 0, iContextAttribs);
+
+	wglMakeCurrent(NULL, NULL);
+	wglDeleteContext(hRCFake);
+
+	if (m_hrc == NULL)
+		return false;
+
+	return wglMakeCurrent(m_hdc, m_hrc) == TRUE;
+}
+
+void CHeadlessContext::DestroyContext()
+{
+	if (m_hrc) {
+		wglMakeCurrent(NULL, NULL);
+		wglDeleteContext(m_hrc);
+		m_hrc = NULL;
+	}
+	if (m_hdc) {
+		ReleaseDC(m_hwnd, m_hdc);
+		m_hdc = NULL;
+	}
+	if (m_hwnd) {
+		DestroyWindow(m_hwnd);
+		m_hwnd = NULL;
+	}
+	UnregisterClass(HEADLESS_OPENGL_CLASS_NAME, GetModuleHandle(NULL));
+}
+
+#else
+
+// EGL backend:  a surfaceless display (EGL_MESA_platform_surfaceless) needs no X server or GPU.  The context is made
+// current without a surface (EGL_KHR_surfaceless_context), so the framebuffer object is the only render target.
+// GLEW must be built with GLEW_EGL for glewInit to resolve entry points through eglGetProcAddress.
+bool CHeadlessContext::CreateContext()
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (eglGetPlatformDisplayEXT)
+		m_display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (m_display == EGL_NO_DISPLAY)
+		m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (m_display == EGL_NO_DISPLAY)
+		return false;
+
+	EGLint iMajorVersion, iMinorVersion;
+	if (!eglInitialize(m_display, &iMajorVersion, &iMinorVersion))
+		return false;
+
+	const EGLint configAttribs[] =
+	{
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE // End of attributes list
+	};
+	// The surfaceless platform may expose no configs at all; the context then needs none (EGL_KHR_no_config_context)
+	EGLConfig config = EGL_NO_CONFIG_KHR;
+	EGLint iNumConfigs = 0;
+	if (!eglChooseConfig(m_display, configAttribs, &config, 1, &iNumConfigs) || iNumConfigs == 0)
+		config = EGL_NO_CONFIG_KHR;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+		return false;
+
+	const EGLint contextAttribs[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 0,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE // End of attributes list
+	};
+	m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, contextAttribs);
+	if (m_context == EGL_NO_CONTEXT)
+		return false;
+
+	if (!eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+		return false;
+
+	// Core profile contexts do not list extensions through glGetString(GL_EXTENSIONS), so GLEW has to query all entry points
+	glewExperimental = GL_TRUE;
+	return glewInit() == GLEW_OK;
+}
+
+void CHeadlessContext::DestroyContext()
+{
+	if (m_display == EGL_NO_DISPLAY)
+		return;
+	eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (m_context != EGL_NO_CONTEXT) {
+		eglDestroyContext(m_display, m_context);
+		m_context = EGL_NO_CONTEXT;
+	}
+	eglTerminate(m_display);
+	m_display = EGL_NO_DISPLAY;
+}
+
+#endif
+
+// Create the framebuffer object that takes the place of the window's back buffer
+bool CHeadlessContext::CreateFramebuffer()
+{
+	glGenRenderbuffers(1, &m_colourRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colourRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+
+	glGenRenderbuffers(1, &m_depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colourRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthRenderbuffer);
+
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+// Bind the offscreen framebuffer.  With no window surface the default viewport is empty, so it is set explicitly.
+void CHeadlessContext::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+	glViewport(0, 0, m_width, m_height);
+}
+
+// Block until the GPU has finished the frame, so that timing the game loop includes the cost of rendering
+void CHeadlessContext::Present()
+{
+	glFinish();
+}
+
+// Delete the framebuffer and release the context
+void CHeadlessContext::Release()
+{
+	if (m_fbo) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &m_fbo);
+		m_fbo = 0;
+	}
+	if (m_colourRenderbuffer) {
+		glDeleteRenderbuffers(1, &m_colourRenderbuffer);
+		m_colourRenderbuffer = 0;
+	}
+	if (m_depthRenderbuffer) {
+		glDeleteRenderbuffers(1, &m_depthRenderbuffer);
+		m_depthRenderbuffer = 0;
+	}
+	DestroyContext();
+}
+
+int CHeadlessContext::GetWidth()
+{
+	return m_width;
+}
+
+int CHeadlessContext::GetHeight()
+{
+	return m_height;
+}
+
+bool CHeadlessContext::HasInput()
+{
+	return false;
+}
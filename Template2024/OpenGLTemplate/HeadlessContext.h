@@ -0,0 +1,51 @@
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#include "include/gl/glew.h"
+#else
+#include "include/gl/glew.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "PlatformContext.h"
+
+// Offscreen OpenGL 4.0 core context that renders into a framebuffer object instead of a window, so the renderer can
+// run on machines with no display.  On Windows the context is created with WGL on a hidden window that is never shown;
+// elsewhere a surfaceless EGL display is used, which needs no X server or GPU (e.g. Mesa llvmpipe).  This file has no
+// other dependencies on the game, so it builds on Linux on its own.
+class CHeadlessContext : public CPlatformContext
+{
+public:
+	CHeadlessContext();
+	~CHeadlessContext();
+
+	bool Create(int width, int height);		// Creates the context and the offscreen framebuffer
+	void Bind();							// Makes the offscreen framebuffer the current render target
+	void Present();							// Waits for the frame to complete -- the headless equivalent of SwapBuffers
+	void Release();							// Deletes the framebuffer and the context
+
+	int GetWidth();
+	int GetHeight();
+	bool HasInput();
+
+private:
+	bool CreateContext();
+	bool CreateFramebuffer();
+	void DestroyContext();
+
+#ifdef _WIN32
+	HWND m_hwnd;
+	HDC m_hdc;
+	HGLRC m_hrc;
+#else
+	EGLDisplay m_display;
+	EGLContext m_context;
+#endif
+
+	GLuint m_fbo;					// Offscreen framebuffer
+	GLuint m_colourRenderbuffer;	// Colour attachment
+	GLuint m_depthRenderbuffer;		// Depth / stencil attachment
+	int m_width, m_height;
+};
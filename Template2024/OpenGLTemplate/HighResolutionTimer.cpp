@@ -23,6 +23,7 @@ double CHighResolutionTimer::Elapsed()
 	LARGE_INTEGER frequency;
 	QueryPerformanceFrequency(&frequency);
 
-	QueryPerformanceCounter(&m_t2);
-	return (double) (m_t2.QuadPart - m_t1.QuadPart) * 1000.0f / frequency.QuadPart;
+	LARGE_INTEGER t2;
+	QueryPerformanceCounter(&t2);
+	return (double) (t2.QuadPart - m_t1.QuadPart) * 1000.0f / frequency.QuadPart;
 }
\ No newline at end of file
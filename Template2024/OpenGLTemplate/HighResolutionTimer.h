@@ -9,9 +9,9 @@ public:
 	~CHighResolutionTimer();
 
 	void Start();
-	double Elapsed();
+	double Elapsed();		// Milliseconds since Start.  Only reads the timer, so any thread can call it.
 
 private:
-	LARGE_INTEGER m_t1, m_t2;
+	LARGE_INTEGER m_t1;
 	bool m_started;
 };
@@ -0,0 +1,77 @@
+#include "InstanceBuffer.h"
+
+CInstanceBuffer::CInstanceBuffer()
+{
+	m_buffer = 0;
+	m_count = 0;
+	m_capacity = 0;
+}
+
+CInstanceBuffer::~CInstanceBuffer()
+{
+	Release();
+}
+
+void CInstanceBuffer::Create()
+{
+	glGenBuffers(1, &m_buffer);
+	m_count = 0;
+	m_capacity = 0;
+}
+
+void CInstanceBuffer::Release()
+{
+	if (m_buffer != 0)
+		glDeleteBuffers(1, &m_buffer);
+	m_buffer = 0;
+	m_count = 0;
+	m_capacity = 0;
+}
+
+// The buffer keeps its name when it grows or is orphaned, so the VAOs that read it stay valid
+void CInstanceBuffer::Upload(const vector<InstanceData>& instances)
+{
+	m_count = (int)instances.size();
+	if (m_count > m_capacity)
+		m_capacity = max(m_count, m_capacity * 2);
+	if (m_capacity == 0)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+	glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	if (m_count > 0)
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(InstanceData), &instances[0]);
+}
+
+void CInstanceBuffer::SetAttributes()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+	GLsizei stride = sizeof(InstanceData);
+	for (int i = 0; i < 4; i++) {
+		GLuint location = INSTANCE_MATRIX_ATTRIBUTE + i;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (const GLvoid*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(location, 1);
+	}
+	glEnableVertexAttribArray(INSTANCE_COLOUR_ATTRIBUTE);
+	glVertexAttribPointer(INSTANCE_COLOUR_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, stride,
+		(const GLvoid*)offsetof(InstanceData, colour));
+	glVertexAttribDivisor(INSTANCE_COLOUR_ATTRIBUTE, 1);
+	glEnableVertexAttribArray(INSTANCE_ANIMATION_ATTRIBUTE);
+	glVertexAttribPointer(INSTANCE_ANIMATION_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, stride,
+		(const GLvoid*)offsetof(InstanceData, phase));
+	glVertexAttribDivisor(INSTANCE_ANIMATION_ATTRIBUTE, 1);
+}
+
+// The current attribute values are context state, and may be left undefined by an instanced draw that read the
+// attributes from a buffer, so they are set again after each run of instanced draws
+void CInstanceBuffer::SetDefaultAttributes()
+{
+	for (int i = 0; i < 4; i++) {
+		glm::vec4 column(0.0f);
+		column[i] = 1.0f;
+		glVertexAttrib4f(INSTANCE_MATRIX_ATTRIBUTE + i, column.x, column.y, column.z, column.w);
+	}
+	glVertexAttrib4f(INSTANCE_COLOUR_ATTRIBUTE, 1.0f, 1.0f, 1.0f, 1.0f);
+	glVertexAttrib2f(INSTANCE_ANIMATION_ATTRIBUTE, 0.0f, 0.0f);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Common.h"
+
+// Per-instance data for the instanced path of the meshes.  The vertex shaders apply it before the object's modelview
+// matrix:  the instance is turned about its own y axis by phase + spin * time, then placed by the model matrix, and its
+// lit colour is multiplied by colour.  The model matrix must scale uniformly, since it also transforms the normals.
+struct InstanceData
+{
+	glm::mat4 modelMatrix;
+	glm::vec4 colour;
+	float phase;		// Radians
+	float spin;			// Radians per second
+	float pad[2];
+};
+
+// Vertex attribute locations of the instance data, after the meshes' own position, texture coordinate and normal
+enum InstanceAttribute
+{
+	INSTANCE_MATRIX_ATTRIBUTE = 3,		// The four columns take locations 3 to 6
+	INSTANCE_COLOUR_ATTRIBUTE = 7,
+	INSTANCE_ANIMATION_ATTRIBUTE = 8,	// phase, spin
+};
+
+// A vertex buffer of InstanceData, read by a mesh's instanced VAO with a divisor of one, so a single instanced draw
+// covers every instance.  It is refilled whole, orphaning the old storage so the upload does not wait for the GPU.
+//
+// Draws that are not instanced leave the instance attributes disabled and read their current values instead, which
+// SetDefaultAttributes sets to an identity transform, white and no animation.
+class CInstanceBuffer
+{
+public:
+	CInstanceBuffer();
+	~CInstanceBuffer();
+
+	void Create();
+	void Release();
+	void Upload(const vector<InstanceData>& instances);	// Replaces the instances, growing the buffer if needed
+	int GetCount() const { return m_count; }
+
+	void SetAttributes();					// Point the instance attributes of the bound VAO at this buffer
+	static void SetDefaultAttributes();
+
+private:
+	GLuint m_buffer;
+	int m_count;
+	int m_capacity;		// Instances the buffer has room for
+};
@@ -0,0 +1,224 @@
+#include "JobSystem.h"
+
+// Index of the worker the current thread is, or -1 for any other thread
+static thread_local int t_worker = -1;
+
+CJobCounter::CJobCounter() : m_count(0)
+{}
+
+CJobSystem& CJobSystem::GetInstance()
+{
+	static CJobSystem instance;
+	return instance;
+}
+
+// The workers start with the first use, so nothing needs to set the system up before running jobs
+CJobSystem::CJobSystem() : m_running(false), m_numQueued(0), m_nextQueue(0)
+{
+	Start();
+}
+
+CJobSystem::~CJobSystem()
+{
+	Stop();
+}
+
+void CJobSystem::Start(int numWorkers)
+{
+	Stop();
+
+	if (numWorkers < 0)
+		numWorkers = max((int)std::thread::hardware_concurrency() - 1, 0);
+
+	m_running = true;
+	for (int i = 0; i < numWorkers; i++)
+		m_queues.push_back(new WorkerQueue);
+	for (int i = 0; i < numWorkers; i++)
+		m_workers.push_back(std::thread(&CJobSystem::WorkerThread, this, i));
+}
+
+void CJobSystem::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_running = false;
+	}
+	m_wake.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+		m_workers[i].join();
+	m_workers.clear();
+
+	for (size_t i = 0; i < m_queues.size(); i++)
+		delete m_queues[i];
+	m_queues.clear();
+}
+
+int CJobSystem::GetNumWorkers() const
+{
+	return (int)m_workers.size();
+}
+
+void CJobSystem::Run(JobFunction function, CJobCounter* counter)
+{
+	if (counter != NULL)
+		counter->m_count.fetch_add(1, std::memory_order_relaxed);
+	Job job = { function, counter };
+	Submit(job);
+}
+
+// The counter is checked under its lock, so either the dependency is already done and the job runs now, or the job
+// is added before the last of the dependency's jobs takes the list
+void CJobSystem::RunAfter(CJobCounter& dependency, JobFunction function, CJobCounter* counter)
+{
+	{
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (!dependency.IsDone()) {
+			if (counter != NULL)
+				counter->m_count.fetch_add(1, std::memory_order_relaxed);
+			CJobCounter::Continuation continuation = { function, counter };
+			dependency.m_continuations.push_back(continuation);
+			return;
+		}
+	}
+	Run(function, counter);
+}
+
+// Queue a job whose counter already includes it
+void CJobSystem::Submit(Job& job)
+{
+	if (m_queues.empty())
+		Execute(job);
+	else
+		Push(job);
+}
+
+// Run queued jobs, the counter's own or any others, until the counter reaches zero.  Taking the counter's lock at the
+// end waits for the job that brought it to zero to let go of it, so the caller may then destroy it.
+void CJobSystem::Wait(CJobCounter& counter)
+{
+	Job job;
+	while (!counter.IsDone()) {
+		if (Pop(t_worker, job))
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void CJobSystem::ParallelFor(int count, int grain, const std::function<void(int, int)>& function)
+{
+	grain = max(grain, 1);
+	if (count <= grain || m_queues.empty()) {
+		if (count > 0)
+			function(0, count);
+		return;
+	}
+
+	// The calling thread takes the last range itself, then helps with the rest
+	CJobCounter counter;
+	int numRanges = (count + grain - 1) / grain;
+	for (int i = 0; i < numRanges - 1; i++) {
+		int begin = (int)((long long)count * i / numRanges), end = (int)((long long)count * (i + 1) / numRanges);
+		Run([&function, begin, end]() { function(begin, end); }, &counter);
+	}
+	function((int)((long long)count * (numRanges - 1) / numRanges), count);
+	Wait(counter);
+}
+
+// A worker's jobs go on its own deque; other threads deal theirs out to the workers in turn
+void CJobSystem::Push(Job& job)
+{
+	// Counted before it is queued, so the count never drops below zero.  Taking the lock orders the count against a
+	// worker deciding to sleep, so the wake-up cannot be missed.
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_numQueued.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	int worker = t_worker >= 0 ? t_worker : (int)(m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size());
+	{
+		std::lock_guard<std::mutex> lock(m_queues[worker]->mutex);
+		m_queues[worker]->jobs.push_back(std::move(job));
+	}
+	m_wake.notify_one();
+}
+
+// Newest job from the worker's own deque, or else the oldest job from another's
+bool CJobSystem::Pop(int worker, Job& job)
+{
+	if (m_numQueued.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	int numQueues = (int)m_queues.size();
+	if (worker >= 0) {
+		WorkerQueue& queue = *m_queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			m_numQueued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	int first = worker >= 0 ? worker + 1 : 0;
+	for (int i = 0; i < numQueues; i++) {
+		int victim = (first + i) % numQueues;
+		if (victim == worker)
+			continue;
+		WorkerQueue& queue = *m_queues[victim];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			m_numQueued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void CJobSystem::Execute(Job& job)
+{
+	job.function();
+	job.function = JobFunction();	// Release what the job captured before anyone waiting on it carries on
+	Finish(job.counter);
+}
+
+// When the last job of a counter finishes, start the jobs that were waiting for it
+void CJobSystem::Finish(CJobCounter* counter)
+{
+	if (counter == NULL)
+		return;
+
+	vector<CJobCounter::Continuation> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (counter->m_count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			return;
+		continuations.swap(counter->m_continuations);
+	}
+	for (size_t i = 0; i < continuations.size(); i++) {
+		Job job = { continuations[i].function, continuations[i].counter };
+		Submit(job);
+	}
+}
+
+void CJobSystem::WorkerThread(int worker)
+{
+	t_worker = worker;
+	Job job;
+	for (;;) {
+		if (Pop(worker, job)) {
+			Execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wake.wait(lock, [this]() { return !m_running || m_numQueued.load(std::memory_order_relaxed) > 0; });
+		if (!m_running && m_numQueued.load(std::memory_order_relaxed) == 0)
+			break;
+	}
+	t_worker = -1;
+}
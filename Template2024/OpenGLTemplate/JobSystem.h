@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Common.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+typedef std::function<void()> JobFunction;
+
+// Counts the jobs run against it that have not finished yet.  Wait on it to know they are all done, or give it jobs with
+// CJobSystem::RunAfter to start them once it reaches zero.  It must outlive the jobs and the waits that use it.
+class CJobCounter
+{
+public:
+	CJobCounter();
+
+	bool IsDone() const { return m_count.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class CJobSystem;
+
+	struct Continuation
+	{
+		JobFunction function;
+		CJobCounter* counter;
+	};
+
+	CJobCounter(const CJobCounter&);
+	void operator=(const CJobCounter&);
+
+	std::atomic<int> m_count;
+	std::mutex m_mutex;						// Held while finishing a job, so waits return only once it lets go
+	vector<Continuation> m_continuations;	// Jobs waiting for the count to reach zero
+};
+
+// Work-stealing job scheduler shared by the whole engine, so subsystems do not each start their own threads.  Every
+// worker has its own deque:  it runs its newest job first, while idle workers steal the oldest jobs from the others,
+// which are the largest pieces of work left.  Jobs run from other threads are dealt out to the workers in turn.
+//
+// A thread that waits for a counter runs queued jobs until the counter reaches zero, so the main thread helps rather
+// than blocking, and a job may wait for jobs of its own.  With no workers (one core, or Start(0)), Run executes the job
+// straight away on the calling thread.
+class CJobSystem
+{
+public:
+	static CJobSystem& GetInstance();
+
+	void Start(int numWorkers = -1);	// -1 for one worker per core besides the calling thread.  Restarts if running.
+	void Stop();						// Waits for the workers to finish the jobs they have
+	int GetNumWorkers() const;
+
+	void Run(JobFunction function, CJobCounter* counter = NULL);
+	void RunAfter(CJobCounter& dependency, JobFunction function, CJobCounter* counter = NULL);
+	void Wait(CJobCounter& counter);
+
+	// Call function(begin, end) on ranges of about grain items covering [0, count), and wait for them all.  A range
+	// of grain items should be worth more than a job's overhead, which is a few microseconds.  The function must only
+	// write to its own range of the output.
+	void ParallelFor(int count, int grain, const std::function<void(int, int)>& function);
+
+private:
+	struct Job
+	{
+		JobFunction function;
+		CJobCounter* counter;
+	};
+
+	// One worker's jobs.  A lock per deque keeps stealing simple; contention is low because owners and thieves
+	// rarely touch the same deque at once.
+	struct WorkerQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	CJobSystem();
+	~CJobSystem();
+	CJobSystem(const CJobSystem&);
+	void operator=(const CJobSystem&);
+
+	void Submit(Job& job);
+	void Push(Job& job);
+	bool Pop(int worker, Job& job);		// worker is -1 for a thread that is not a worker
+	void Execute(Job& job);
+	void Finish(CJobCounter* counter);
+	void WorkerThread(int worker);
+
+	vector<WorkerQueue*> m_queues;
+	vector<std::thread> m_workers;
+	std::atomic<bool> m_running;
+	std::atomic<int> m_numQueued;		// Jobs in all the deques, so idle workers know when to sleep
+	std::atomic<unsigned int> m_nextQueue;	// Where the next job from a non-worker thread goes
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+};
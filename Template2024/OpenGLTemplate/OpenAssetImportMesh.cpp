@@ -18,19 +18,30 @@
 
 #include <assert.h>
 #include "OpenAssetImportMesh.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
 
 #pragma comment(lib, "lib/assimp.lib")
 
 COpenAssetImportMesh::MeshEntry::MeshEntry()
 {
+    vao = INVALID_OGL_VALUE;
     vbo = INVALID_OGL_VALUE;
     ibo = INVALID_OGL_VALUE;
     NumIndices  = 0;
     MaterialIndex = INVALID_MATERIAL;
+    instancedVao = INVALID_OGL_VALUE;
 };
 
 COpenAssetImportMesh::MeshEntry::~MeshEntry()
 {
+    if (vao != INVALID_OGL_VALUE)
+        glDeleteVertexArrays(1, &vao);
+
+    if (instancedVao != INVALID_OGL_VALUE)
+        glDeleteVertexArrays(1, &instancedVao);
+
     if (vbo != INVALID_OGL_VALUE)
         glDeleteBuffers(1, &vbo);
 
@@ -43,6 +54,9 @@ void COpenAssetImportMesh::MeshEntry::Init(const std::vector<Vertex>& Vertices,
 {
     NumIndices = int(Indices.size());
 
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
 	glGenBuffers(1, &vbo);
   	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
@@ -50,10 +64,26 @@ void COpenAssetImportMesh::MeshEntry::Init(const std::vector<Vertex>& Vertices,
     glGenBuffers(1, &ibo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * NumIndices, &Indices[0], GL_STATIC_DRAW);
+
+	SetVertexAttributes();
+	glBindVertexArray(0);
+}
+
+void COpenAssetImportMesh::MeshEntry::SetVertexAttributes()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)12);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)20);
 }
 
 COpenAssetImportMesh::COpenAssetImportMesh()
 {
+    m_pInstances = NULL;
 }
 
 
@@ -68,12 +98,13 @@ void COpenAssetImportMesh::Clear()
     for (unsigned int i = 0 ; i < m_Textures.size() ; i++) {
         SAFE_DELETE(m_Textures[i]);
     }
-	glDeleteVertexArrays(1, &m_vao);
 }
 
 
 bool COpenAssetImportMesh::Load(const std::string& Filename)
 {
+    PROFILE_ZONE("Mesh::Load");
+
     // Release the previously loaded mesh (if it exists)
     Clear();
     
@@ -96,10 +127,7 @@ bool COpenAssetImportMesh::InitFromScene(const aiScene* pScene, const std::strin
 {  
     m_Entries.resize(pScene->mNumMeshes);
     m_Textures.resize(pScene->mNumMaterials);
-
-	glGenVertexArrays(1, &m_vao); 
-	glBindVertexArray(m_vao);
-
+    m_boundingBox = BoundingBox();
 
     // Initialize the meshes in the scene one by one
     for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
@@ -107,6 +135,16 @@ bool COpenAssetImportMesh::InitFromScene(const aiScene* pScene, const std::strin
         InitMesh(i, paiMesh);
     }
 
+    // The sphere is centred on the box around all the entries, so needs a second pass over the vertices
+    m_boundingSphere = BoundingSphere(m_boundingBox.Centre(), 0.0f);
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        const aiMesh* paiMesh = pScene->mMeshes[i];
+        for (unsigned int j = 0 ; j < paiMesh->mNumVertices ; j++) {
+            const aiVector3D& Pos = paiMesh->mVertices[j];
+            m_boundingSphere.Include(glm::vec3(Pos.x, Pos.y, Pos.z));
+        }
+    }
+
     return InitMaterials(pScene, Filename);
 }
 
@@ -129,6 +167,7 @@ void COpenAssetImportMesh::InitMesh(unsigned int Index, const aiMesh* paiMesh)
                  glm::vec3(pNormal->x, pNormal->y, pNormal->z));
 
         Vertices.push_back(v);
+        m_boundingBox.Include(v.m_pos);
     }
 
     for (unsigned int i = 0 ; i < paiMesh->mNumFaces ; i++) {
@@ -205,20 +244,50 @@ bool COpenAssetImportMesh::InitMaterials(const aiScene* pScene, const std::strin
 
 void COpenAssetImportMesh::Render()
 {
-	glBindVertexArray(m_vao);
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        glBindVertexArray(m_Entries[i].vao);
+
+        const unsigned int MaterialIndex = m_Entries[i].MaterialIndex;
+
+        if (MaterialIndex < m_Textures.size() && m_Textures[MaterialIndex]) {
+            m_Textures[MaterialIndex]->Bind(0);
+        }
 
+        glDrawElements(GL_TRIANGLES, m_Entries[i].NumIndices, GL_UNSIGNED_INT, 0);
+    }
+
+    glBindVertexArray(0);
+}
+
+void COpenAssetImportMesh::Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
     for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
-        glBindBuffer(GL_ARRAY_BUFFER, m_Entries[i].vbo);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)12);
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const GLvoid*)20);
+        const unsigned int MaterialIndex = m_Entries[i].MaterialIndex;
+        CTexture* pTexture = MaterialIndex < m_Textures.size() ? m_Textures[MaterialIndex] : NULL;
+        queue->Submit(m_Entries[i].vao, pTexture, GL_TRIANGLES, 0, m_Entries[i].NumIndices, GL_UNSIGNED_INT, modelViewMatrix);
+    }
+}
 
+void COpenAssetImportMesh::CreateInstanced(CInstanceBuffer* pInstances)
+{
+    m_pInstances = pInstances;
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        glGenVertexArrays(1, &m_Entries[i].instancedVao);
+        glBindVertexArray(m_Entries[i].instancedVao);
+        m_Entries[i].SetVertexAttributes();
+        pInstances->SetAttributes();
+    }
+    glBindVertexArray(0);
+}
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_Entries[i].ibo);
+// One draw per mesh entry, for every instance in the buffer given to CreateInstanced
+void COpenAssetImportMesh::RenderInstanced()
+{
+    if (m_pInstances->GetCount() == 0)
+        return;
 
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        glBindVertexArray(m_Entries[i].instancedVao);
 
         const unsigned int MaterialIndex = m_Entries[i].MaterialIndex;
 
@@ -226,13 +295,22 @@ void COpenAssetImportMesh::Render()
             m_Textures[MaterialIndex]->Bind(0);
         }
 
-
-        glDrawElements(GL_TRIANGLES, m_Entries[i].NumIndices, GL_UNSIGNED_INT, 0);
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+        glDrawElementsInstanced(GL_TRIANGLES, m_Entries[i].NumIndices, GL_UNSIGNED_INT, 0, m_pInstances->GetCount());
     }
 
+    glBindVertexArray(0);
+    CInstanceBuffer::SetDefaultAttributes();
+}
 
+void COpenAssetImportMesh::SubmitInstanced(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+    if (m_pInstances->GetCount() == 0)
+        return;
 
+    for (unsigned int i = 0 ; i < m_Entries.size() ; i++) {
+        const unsigned int MaterialIndex = m_Entries[i].MaterialIndex;
+        CTexture* pTexture = MaterialIndex < m_Textures.size() ? m_Textures[MaterialIndex] : NULL;
+        queue->Submit(m_Entries[i].instancedVao, pTexture, GL_TRIANGLES, 0, m_Entries[i].NumIndices, GL_UNSIGNED_INT,
+            modelViewMatrix, m_pInstances->GetCount());
+    }
 }
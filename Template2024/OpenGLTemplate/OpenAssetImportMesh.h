@@ -29,6 +29,10 @@
 
 #include "Common.h"
 #include "Texture.h"
+#include "Bounds.h"
+
+class CRenderQueue;
+class CInstanceBuffer;
 
 #define INVALID_OGL_VALUE 0xFFFFFFFF
 #define SAFE_DELETE(p) if (p) { delete p; p = NULL; }
@@ -58,6 +62,12 @@ public:
     ~COpenAssetImportMesh();
     bool Load(const std::string& Filename);
     void Render();
+    void Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix);	// One draw per mesh entry
+    void CreateInstanced(CInstanceBuffer* pInstances);	// Second VAOs that also read pInstances, for the instanced path
+    void RenderInstanced();
+    void SubmitInstanced(CRenderQueue* queue, const glm::mat4& modelViewMatrix);
+    const BoundingBox& GetBoundingBox() const { return m_boundingBox; }	// Around every entry, in model coordinates
+    const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 
 private:
     bool InitFromScene(const aiScene* pScene, const std::string& Filename);
@@ -75,15 +85,21 @@ private:
 
         void Init(const std::vector<Vertex>& Vertices,
                   const std::vector<unsigned int>& Indices);
+        void SetVertexAttributes();
+
+        GLuint vao;		// Holds the entry's attribute layout, so drawing it only needs a bind
         GLuint vbo;
         GLuint ibo;
         unsigned int NumIndices;
         unsigned int MaterialIndex;
+        GLuint instancedVao;
     };
 
     std::vector<MeshEntry> m_Entries;
     std::vector<CTexture*> m_Textures;
-	GLuint m_vao;
+    CInstanceBuffer* m_pInstances;
+    BoundingBox m_boundingBox;
+    BoundingSphere m_boundingSphere;
 };
 
 
@@ -0,0 +1,70 @@
+#include "PickupPlacer.h"
+
+CPickupPlacer::CPickupPlacer()
+{
+	m_numColumns = 0;
+	m_numRows = 0;
+	m_length = 0.0f;
+	m_minSpacingSquared = 0.0f;
+}
+
+CPickupPlacer::~CPickupPlacer()
+{}
+
+int CPickupPlacer::Place(unsigned long long seed, int count, float minSpacing, float length, float halfWidth,
+	vector<PickupPlacement>& placements)
+{
+	placements.clear();
+	if (count <= 0 || length <= 0.0f || halfWidth < 0.0f || minSpacing <= 0.0f)
+		return 0;
+
+	// A cell's diagonal is at most minSpacing, so no cell can hold two pickups.  The columns divide the lap exactly, so
+	// the grid wraps around the start line like the track does; they are never wider than a row is high.
+	float cellSize = minSpacing / sqrtf(2.0f);
+	m_numColumns = max(1, (int)ceilf(length / cellSize));
+	m_numRows = max(1, (int)ceilf(2.0f * halfWidth / cellSize));
+	float columnWidth = length / m_numColumns;
+	m_length = length;
+	m_minSpacingSquared = minSpacing * minSpacing;
+	m_cells.assign((size_t)m_numColumns * m_numRows, -1);
+	m_random.Seed(seed);
+	placements.reserve(count);
+
+	int attempts = 0, maxAttempts = count * MAX_ATTEMPTS_PER_PICKUP;
+	while ((int)placements.size() < count && attempts < maxAttempts) {
+		attempts++;
+		PickupPlacement candidate;
+		candidate.distance = m_random.NextFloat(0.0f, length);
+		candidate.lateralOffset = m_random.NextFloat(-halfWidth, halfWidth);
+		int column = min((int)(candidate.distance / columnWidth), m_numColumns - 1);
+		int row = min((int)((candidate.lateralOffset + halfWidth) / cellSize), m_numRows - 1);
+		if (m_cells[row * m_numColumns + column] >= 0 || !IsFarEnough(candidate, column, row, placements))
+			continue;
+
+		m_cells[row * m_numColumns + column] = (int)placements.size();
+		placements.push_back(candidate);
+	}
+	return (int)placements.size();
+}
+
+// Pickups closer than minSpacing can only be within two cells in each direction
+bool CPickupPlacer::IsFarEnough(const PickupPlacement& candidate, int column, int row,
+	const vector<PickupPlacement>& placements)
+{
+	int rowMin = max(row - 2, 0), rowMax = min(row + 2, m_numRows - 1);
+	for (int i = -2; i <= 2; i++) {
+		int c = ((column + i) % m_numColumns + m_numColumns) % m_numColumns;
+		for (int r = rowMin; r <= rowMax; r++) {
+			int index = m_cells[r * m_numColumns + c];
+			if (index < 0)
+				continue;
+			const PickupPlacement& other = placements[index];
+			float dd = fabsf(candidate.distance - other.distance);
+			dd = min(dd, m_length - dd);
+			float dl = candidate.lateralOffset - other.lateralOffset;
+			if (dd * dd + dl * dl < m_minSpacingSquared)
+				return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Common.h"
+#include "Random.h"
+
+// Where a pickup sits, in track space:  distance along the lap and offset along the frame's sideways vector
+struct PickupPlacement
+{
+	float distance;
+	float lateralOffset;
+};
+
+// Scatters pickups over the track with a minimum spacing between any two of them (Poisson-disk sampling by dart
+// throwing).  Candidates are drawn uniformly over the strip [0, length) x [-halfWidth, halfWidth] in track space,
+// which wraps around the lap in distance, and a grid over the strip finds the placed pickups that could be too close
+// to a candidate in constant time.  Cells are small enough to hold at most one pickup, so the grid is a flat array of
+// indices.  The same seed always gives the same placements.
+class CPickupPlacer
+{
+public:
+	CPickupPlacer();
+	~CPickupPlacer();
+
+	// Place up to count pickups at least minSpacing apart, replacing the contents of placements.  Gives up after
+	// MAX_ATTEMPTS_PER_PICKUP failed candidates per pickup, so returns fewer than count if the strip is too full.
+	int Place(unsigned long long seed, int count, float minSpacing, float length, float halfWidth,
+		vector<PickupPlacement>& placements);
+
+private:
+	static const int MAX_ATTEMPTS_PER_PICKUP = 30;
+
+	bool IsFarEnough(const PickupPlacement& candidate, int column, int row, const vector<PickupPlacement>& placements);
+
+	CRandom m_random;
+	vector<int> m_cells;		// Index of the pickup in each cell, or -1; row-major, m_numColumns per row
+	int m_numColumns;
+	int m_numRows;
+	float m_length;
+	float m_minSpacingSquared;
+};
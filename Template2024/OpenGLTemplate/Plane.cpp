@@ -1,5 +1,6 @@
 #include "Common.h"
 #include "Plane.h"
+#include "RenderQueue.h"
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
 
@@ -68,6 +69,7 @@ void CPlane::Create(string directory, string filename, float width, float height
 		m_vbo.AddData(&planeTexCoords[i], sizeof(glm::vec2));
 		m_vbo.AddData(&planeNormal, sizeof(glm::vec3));
 	}
+	ComputeBounds(planeVertices, 4, m_boundingBox, m_boundingSphere);
 
 
 	// Upload the VBO to the GPU
@@ -97,6 +99,11 @@ void CPlane::Render()
 	
 }
 
+void CPlane::Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	queue->Submit(m_vao, &m_texture, GL_TRIANGLE_STRIP, 0, 4, 0, modelViewMatrix);
+}
+
 // Release resources
 void CPlane::Release()
 {
@@ -2,6 +2,9 @@
 
 #include "Texture.h"
 #include "VertexBufferObject.h"
+#include "Bounds.h"
+
+class CRenderQueue;
 
 // Class for generating a xz plane of a given size
 class CPlane
@@ -11,6 +14,9 @@ public:
 	~CPlane();
 	void Create(string sDirectory, string sFilename, float fWidth, float fHeight, float fTextureRepeat);
 	void Render();
+	void Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix);
+	const BoundingBox& GetBoundingBox() const { return m_boundingBox; }
+	const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 	void Release();
 private:
 	UINT m_vao;
@@ -20,4 +26,6 @@ private:
 	string m_filename;
 	float m_width;
 	float m_height;
+	BoundingBox m_boundingBox;		// Around the vertices, in object coordinates
+	BoundingSphere m_boundingSphere;
 };
\ No newline at end of file
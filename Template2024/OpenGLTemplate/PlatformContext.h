@@ -0,0 +1,15 @@
+#pragma once
+
+// The platform layer the game renders through.  There are two implementations:  GameWindow, which draws into a window
+// and takes keyboard and mouse input, and CHeadlessContext, which draws into an offscreen framebuffer with no window
+// or input (WGL on Windows, surfaceless EGL elsewhere).  The OpenGL context is current once either has been created.
+class CPlatformContext
+{
+public:
+	virtual ~CPlatformContext() {}
+
+	virtual int GetWidth() = 0;			// Size of the render target in pixels
+	virtual int GetHeight() = 0;
+	virtual bool HasInput() = 0;		// False if there is no keyboard or mouse to drive the camera
+	virtual void Present() = 0;			// Shows the finished frame, or waits for it when there is nothing to show it on
+};
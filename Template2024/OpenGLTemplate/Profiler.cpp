@@ -0,0 +1,257 @@
+#include "Profiler.h"
+
+#include "FreeTypeFont.h"
+
+static const double AVERAGE_WEIGHT = 0.05;		// Weight of the newest frame in the overlay's moving averages
+
+// Per-thread state:  the ring the thread writes to, and how deeply its zones are currently nested
+static thread_local int t_ring = -1;
+static thread_local int t_depth = 0;
+
+CProfileRing::CProfileRing() : m_head(0), m_tail(0)
+{}
+
+bool CProfileRing::Push(const ProfileEvent& event)
+{
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+	if (head - m_tail.load(std::memory_order_acquire) == SIZE)
+		return false;
+	m_events[head & (SIZE - 1)] = event;
+	m_head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+bool CProfileRing::Pop(ProfileEvent& event)
+{
+	unsigned int tail = m_tail.load(std::memory_order_relaxed);
+	if (tail == m_head.load(std::memory_order_acquire))
+		return false;
+	event = m_events[tail & (SIZE - 1)];
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+CProfiler::CProfiler() : m_numThreads(0)
+{
+	m_numTraceEvents = 0;
+	m_gpuFrame = 0;
+	m_gpuZoneOpen = false;
+	m_gpuQueriesCreated = false;
+	for (int i = 0; i < GPU_FRAME_LATENCY; i++)
+		m_gpuFrames[i].numQueries = 0;
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	m_ticksPerMillisecond = frequency.QuadPart / 1000.0;
+	m_startTicks = GetTicks();
+}
+
+CProfiler& CProfiler::GetInstance()
+{
+	static CProfiler instance;
+
+	return instance;
+}
+
+long long CProfiler::GetTicks()
+{
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart;
+}
+
+double CProfiler::TicksToMilliseconds(long long ticks)
+{
+	return ticks / m_ticksPerMillisecond;
+}
+
+// The first zone recorded on a thread claims a ring for it.  Threads beyond MAX_THREADS are not profiled.
+CProfileRing* CProfiler::GetThreadRing()
+{
+	if (t_ring < 0)
+		t_ring = m_numThreads.fetch_add(1);
+	return t_ring < MAX_THREADS ? &m_rings[t_ring] : NULL;
+}
+
+void CProfiler::BeginZone()
+{
+	t_depth++;
+}
+
+void CProfiler::EndZone(const char* name, long long beginTicks)
+{
+	t_depth--;
+
+	CProfileRing* ring = GetThreadRing();
+	if (ring == NULL)
+		return;
+
+	ProfileEvent event;
+	event.name = name;
+	event.beginTicks = beginTicks;
+	event.endTicks = GetTicks();
+	event.depth = t_depth;
+	ring->Push(event);
+}
+
+// Start a GPU timer query.  Returns false if the zone is not timed:  another GPU zone is open, or the frame is out of queries.
+bool CProfiler::BeginGpuZone(const char* name)
+{
+	GpuFrame& frame = m_gpuFrames[m_gpuFrame];
+	if (m_gpuZoneOpen || frame.numQueries == MAX_GPU_ZONES)
+		return false;
+
+	if (!m_gpuQueriesCreated) {
+		for (int i = 0; i < GPU_FRAME_LATENCY; i++)
+			glGenQueries(MAX_GPU_ZONES, m_gpuFrames[i].queries);
+		m_gpuQueriesCreated = true;
+	}
+
+	frame.names[frame.numQueries] = name;
+	frame.beginTicks[frame.numQueries] = GetTicks();
+	glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.numQueries]);
+	m_gpuZoneOpen = true;
+	return true;
+}
+
+void CProfiler::EndGpuZone()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	m_gpuFrames[m_gpuFrame].numQueries++;
+	m_gpuZoneOpen = false;
+}
+
+// Read back the results of a frame's queries.  By the time a frame slot is reused the results are normally available,
+// so this rarely waits.
+void CProfiler::CollectGpuFrame(GpuFrame& frame)
+{
+	for (int i = 0; i < frame.numQueries; i++) {
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &nanoseconds);
+
+		ZoneStats& stats = FindZoneStats(frame.names[i], 0);
+		stats.gpuFrameTime += nanoseconds / 1e6;
+		stats.hasGpuTime = true;
+
+		// GPU zones go on their own track, starting when the commands were issued
+		ProfileEvent event;
+		event.name = frame.names[i];
+		event.beginTicks = frame.beginTicks[i];
+		event.endTicks = frame.beginTicks[i] + (long long) (nanoseconds / 1e6 * m_ticksPerMillisecond);
+		event.depth = 0;
+		AddTraceEvent(event, MAX_THREADS);
+	}
+	frame.numQueries = 0;
+}
+
+// Zones are identified by name; the depth of the first occurrence is used to indent the overlay
+CProfiler::ZoneStats& CProfiler::FindZoneStats(const char* name, int depth)
+{
+	for (unsigned int i = 0; i < m_zoneStats.size(); i++) {
+		if (m_zoneStats[i].name == name || strcmp(m_zoneStats[i].name, name) == 0)
+			return m_zoneStats[i];
+	}
+
+	ZoneStats stats;
+	stats.name = name;
+	stats.depth = depth;
+	stats.cpuFrameTime = stats.cpuAverageTime = 0.0;
+	stats.gpuFrameTime = stats.gpuAverageTime = 0.0;
+	stats.hasGpuTime = false;
+	m_zoneStats.push_back(stats);
+	return m_zoneStats.back();
+}
+
+void CProfiler::AddTraceEvent(const ProfileEvent& event, int thread)
+{
+	TraceEvent traceEvent;
+	traceEvent.event = event;
+	traceEvent.thread = thread;
+	if (m_traceEvents.size() < MAX_TRACE_EVENTS)
+		m_traceEvents.push_back(traceEvent);
+	else
+		m_traceEvents[m_numTraceEvents % MAX_TRACE_EVENTS] = traceEvent;
+	m_numTraceEvents++;
+}
+
+// Called by the main thread after each frame:  drain every thread's ring, read back old GPU queries and update the averages
+void CProfiler::EndFrame()
+{
+	int numThreads = min((int) m_numThreads.load(), (int) MAX_THREADS);
+	for (int thread = 0; thread < numThreads; thread++) {
+		ProfileEvent event;
+		while (m_rings[thread].Pop(event)) {
+			FindZoneStats(event.name, event.depth).cpuFrameTime += TicksToMilliseconds(event.endTicks - event.beginTicks);
+			AddTraceEvent(event, thread);
+		}
+	}
+
+	m_gpuFrame = (m_gpuFrame + 1) % GPU_FRAME_LATENCY;
+	CollectGpuFrame(m_gpuFrames[m_gpuFrame]);
+
+	for (unsigned int i = 0; i < m_zoneStats.size(); i++) {
+		ZoneStats& stats = m_zoneStats[i];
+		stats.cpuAverageTime += AVERAGE_WEIGHT * (stats.cpuFrameTime - stats.cpuAverageTime);
+		stats.gpuAverageTime += AVERAGE_WEIGHT * (stats.gpuFrameTime - stats.gpuAverageTime);
+		stats.cpuFrameTime = 0.0;
+		stats.gpuFrameTime = 0.0;
+	}
+}
+
+void CProfiler::Release()
+{
+	if (m_gpuQueriesCreated) {
+		for (int i = 0; i < GPU_FRAME_LATENCY; i++) {
+			glDeleteQueries(MAX_GPU_ZONES, m_gpuFrames[i].queries);
+			m_gpuFrames[i].numQueries = 0;
+		}
+		m_gpuQueriesCreated = false;
+	}
+}
+
+// Draw one line per zone with its average CPU and GPU time, indented by nesting depth.  The caller sets up the font shader.
+void CProfiler::RenderOverlay(CFreeTypeFont* font, int x, int y, int pixelSize)
+{
+	for (unsigned int i = 0; i < m_zoneStats.size(); i++) {
+		const ZoneStats& stats = m_zoneStats[i];
+		int indent = x + stats.depth * pixelSize;
+		if (stats.hasGpuTime)
+			font->Render(indent, y, pixelSize, "%s  cpu %.2f ms  gpu %.2f ms", stats.name, stats.cpuAverageTime, stats.gpuAverageTime);
+		else
+			font->Render(indent, y, pixelSize, "%s  cpu %.2f ms", stats.name, stats.cpuAverageTime);
+		y -= pixelSize;
+	}
+}
+
+// Write the recorded events as "complete" events in the Trace Event Format, which chrome://tracing and Perfetto can load
+bool CProfiler::ExportChromeTrace(string filename)
+{
+	FILE* fp;
+	fopen_s(&fp, filename.c_str(), "wt");
+	if (!fp)
+		return false;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	// Oldest first
+	unsigned int numEvents = (unsigned int) m_traceEvents.size();
+	unsigned int first = m_numTraceEvents > MAX_TRACE_EVENTS ? m_numTraceEvents % MAX_TRACE_EVENTS : 0;
+	for (unsigned int i = 0; i < numEvents; i++) {
+		const TraceEvent& traceEvent = m_traceEvents[(first + i) % numEvents];
+		double begin = TicksToMilliseconds(traceEvent.event.beginTicks - m_startTicks) * 1000.0;
+		double duration = TicksToMilliseconds(traceEvent.event.endTicks - traceEvent.event.beginTicks) * 1000.0;
+		fprintf(fp, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f},\n", traceEvent.event.name,
+			traceEvent.thread, begin, duration);
+	}
+
+	// Track names.  The GPU track comes last, so it closes the list.
+	int numThreads = min((int) m_numThreads.load(), (int) MAX_THREADS);
+	for (int thread = 0; thread < numThreads; thread++)
+		fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}},\n",
+			thread, thread == 0 ? "Main" : "Thread", thread);
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}\n", (int) MAX_THREADS);
+
+	fprintf(fp, "]}\n");
+	fclose(fp);
+	return true;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+
+// Set PROFILER_ENABLED to 0 (e.g. in the preprocessor definitions) to compile every profiling zone out of the build
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+class CFreeTypeFont;
+
+// One completed CPU zone.  Names must be string literals (or otherwise outlive the profiler), since only the pointer is stored.
+struct ProfileEvent
+{
+	const char* name;
+	long long beginTicks;
+	long long endTicks;
+	int depth;
+};
+
+// Fixed-size single-producer / single-consumer ring of events.  The owning thread pushes when a zone ends and the
+// main thread pops in CProfiler::EndFrame; neither side takes a lock.  Events are dropped when the ring is full.
+class CProfileRing
+{
+public:
+	CProfileRing();
+
+	bool Push(const ProfileEvent& event);
+	bool Pop(ProfileEvent& event);
+
+	enum { SIZE = 4096 };	// Power of two
+
+private:
+	ProfileEvent m_events[SIZE];
+	std::atomic<unsigned int> m_head;	// Next slot to write; only changed by the producer
+	std::atomic<unsigned int> m_tail;	// Next slot to read; only changed by the consumer
+};
+
+// Hierarchical frame profiler.  CPU zones nest and can be recorded from any thread (each thread gets its own ring).
+// GPU zones are timed with GL_TIME_ELAPSED queries, which cannot overlap, so a GPU zone opened inside another is ignored;
+// their results are read back GPU_FRAME_LATENCY frames later so that the CPU never waits for the GPU.
+//
+// The main thread calls EndFrame once per frame to collect the events.  Per-zone times are averaged for the overlay, and the
+// most recent events are kept so that they can be written out in the chrome://tracing JSON format.
+class CProfiler
+{
+public:
+	static CProfiler& GetInstance();
+
+	void BeginZone();
+	void EndZone(const char* name, long long beginTicks);
+	bool BeginGpuZone(const char* name);
+	void EndGpuZone();
+	void EndFrame();
+	void Release();		// Deletes the GPU queries; call while the OpenGL context is still current
+
+	void RenderOverlay(CFreeTypeFont* font, int x, int y, int pixelSize);
+	bool ExportChromeTrace(string filename);
+
+	static long long GetTicks();
+
+	enum
+	{
+		MAX_THREADS = 8,
+		MAX_GPU_ZONES = 32,			// Per frame
+		GPU_FRAME_LATENCY = 4,		// Frames between issuing a query and reading its result
+		MAX_TRACE_EVENTS = 65536,
+	};
+
+private:
+	CProfiler();
+	CProfiler(const CProfiler&);
+	void operator=(const CProfiler&);
+
+	// Statistics shown in the overlay, one entry per zone name
+	struct ZoneStats
+	{
+		const char* name;
+		int depth;
+		double cpuFrameTime, cpuAverageTime;	// Milliseconds
+		double gpuFrameTime, gpuAverageTime;
+		bool hasGpuTime;
+	};
+
+	// A trace event:  a CPU zone, or a GPU zone on its own track (thread index MAX_THREADS)
+	struct TraceEvent
+	{
+		ProfileEvent event;
+		int thread;
+	};
+
+	// GPU queries issued in one frame
+	struct GpuFrame
+	{
+		GLuint queries[MAX_GPU_ZONES];
+		const char* names[MAX_GPU_ZONES];
+		long long beginTicks[MAX_GPU_ZONES];
+		int numQueries;
+	};
+
+	CProfileRing* GetThreadRing();
+	ZoneStats& FindZoneStats(const char* name, int depth);
+	void AddTraceEvent(const ProfileEvent& event, int thread);
+	void CollectGpuFrame(GpuFrame& frame);
+	double TicksToMilliseconds(long long ticks);
+
+	CProfileRing m_rings[MAX_THREADS];
+	std::atomic<int> m_numThreads;
+
+	vector<ZoneStats> m_zoneStats;
+	vector<TraceEvent> m_traceEvents;	// Circular once it holds MAX_TRACE_EVENTS
+	unsigned int m_numTraceEvents;
+
+	GpuFrame m_gpuFrames[GPU_FRAME_LATENCY];
+	int m_gpuFrame;
+	bool m_gpuZoneOpen;
+	bool m_gpuQueriesCreated;
+
+	long long m_startTicks;
+	double m_ticksPerMillisecond;
+};
+
+// Scoped CPU zone:  times the enclosing block
+class CProfileZone
+{
+public:
+	CProfileZone(const char* name) : m_name(name), m_beginTicks(CProfiler::GetTicks()) { CProfiler::GetInstance().BeginZone(); }
+	~CProfileZone() { CProfiler::GetInstance().EndZone(m_name, m_beginTicks); }
+
+private:
+	const char* m_name;
+	long long m_beginTicks;
+};
+
+// Scoped GPU zone:  times the OpenGL commands issued in the enclosing block
+class CGpuProfileZone
+{
+public:
+	CGpuProfileZone(const char* name) { m_active = CProfiler::GetInstance().BeginGpuZone(name); }
+	~CGpuProfileZone() { if (m_active) CProfiler::GetInstance().EndGpuZone(); }
+
+private:
+	bool m_active;
+};
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+
+#if PROFILER_ENABLED
+#define PROFILE_ZONE(name) CProfileZone PROFILE_CONCATENATE(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) CGpuProfileZone PROFILE_CONCATENATE(gpuProfileZone, __LINE__)(name)
+#define PROFILE_RENDER_ZONE(name) PROFILE_ZONE(name); PROFILE_GPU_ZONE(name)	// CPU and GPU time of a render pass
+#define PROFILE_END_FRAME() CProfiler::GetInstance().EndFrame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#define PROFILE_RENDER_ZONE(name)
+#define PROFILE_END_FRAME()
+#endif
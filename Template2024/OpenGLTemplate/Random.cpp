@@ -0,0 +1,45 @@
+#include "Random.h"
+
+CRandom::CRandom(unsigned long long seed, unsigned long long stream)
+{
+	Seed(seed, stream);
+}
+
+CRandom::~CRandom()
+{}
+
+// Seeding as in the reference implementation, so the sequences match published PCG32 output
+void CRandom::Seed(unsigned long long seed, unsigned long long stream)
+{
+	m_state = 0;
+	m_increment = (stream << 1) | 1;
+	NextUInt();
+	m_state += seed;
+	NextUInt();
+}
+
+unsigned int CRandom::NextUInt()
+{
+	unsigned long long state = m_state;
+	m_state = state * 6364136223846793005ULL + m_increment;
+	unsigned int xorShifted = (unsigned int)(((state >> 18) ^ state) >> 27);
+	unsigned int rotation = (unsigned int)(state >> 59);
+	return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+}
+
+// Multiply and keep the high half rather than taking a remainder; the bias is below 1 / 2^32 * n
+unsigned int CRandom::NextUInt(unsigned int n)
+{
+	return (unsigned int)(((unsigned long long)NextUInt() * n) >> 32);
+}
+
+// The top 24 bits, so every value is exactly representable and 1 is never returned
+float CRandom::NextFloat()
+{
+	return (NextUInt() >> 8) * (1.0f / 16777216.0f);
+}
+
+float CRandom::NextFloat(float low, float high)
+{
+	return low + (high - low) * NextFloat();
+}
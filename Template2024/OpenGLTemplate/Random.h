@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Common.h"
+
+// Small, fast pseudo-random number generator (PCG32:  a 64-bit LCG with a permuted 32-bit output).  Unlike rand() each
+// generator has its own state, so generators on different threads do not interfere, and a given seed produces the
+// same sequence on every platform.
+class CRandom
+{
+public:
+	CRandom(unsigned long long seed = 0, unsigned long long stream = 0);
+	~CRandom();
+
+	void Seed(unsigned long long seed, unsigned long long stream = 0);	// Streams with the same seed are independent
+	unsigned int NextUInt();
+	unsigned int NextUInt(unsigned int n);		// Uniform in [0, n)
+	float NextFloat();							// Uniform in [0, 1)
+	float NextFloat(float low, float high);		// Uniform in [low, high)
+
+private:
+	unsigned long long m_state;
+	unsigned long long m_increment;				// Selects the stream; always odd
+};
@@ -0,0 +1,217 @@
+#include "RenderQueue.h"
+#include "Shaders.h"
+#include "Texture.h"
+#include "InstanceBuffer.h"
+#include "Profiler.h"
+
+static const int PASS_SHIFT = 60;
+static const int PROGRAM_SHIFT = 52;
+static const int MATERIAL_SHIFT = 44;
+static const int TEXTURE_SHIFT = 32;
+static const int VAO_SHIFT = 20;
+static const unsigned int DEPTH_MAX = (1u << 20) - 1;
+
+CRenderQueue::CRenderQueue()
+{
+	m_pass = RENDER_PASS_OPAQUE;
+	m_pProgram = NULL;
+	m_material = 0;
+	m_farPlane = 1.0f;
+}
+
+CRenderQueue::~CRenderQueue()
+{}
+
+// The vectors keep their storage from frame to frame, so submitting does not allocate once they have grown
+void CRenderQueue::Begin(float farPlane)
+{
+	m_commands.clear();
+	m_materials.clear();
+	m_pass = RENDER_PASS_OPAQUE;
+	m_pProgram = NULL;
+	m_material = 0;
+	m_farPlane = farPlane;
+}
+
+int CRenderQueue::AddMaterial(const MaterialUniforms& material)
+{
+	m_materials.push_back(material);
+	return (int)m_materials.size() - 1;
+}
+
+void CRenderQueue::SetPass(RenderPass pass)
+{
+	m_pass = pass;
+}
+
+void CRenderQueue::SetProgram(CShaderProgram* program)
+{
+	m_pProgram = program;
+}
+
+void CRenderQueue::SetMaterial(int material)
+{
+	m_material = material;
+}
+
+void CRenderQueue::Submit(GLuint vao, CTexture* texture, GLenum mode, GLint first, GLsizei count, GLenum indexType,
+	const glm::mat4& modelViewMatrix, GLsizei instanceCount)
+{
+	RenderCommand command;
+	command.pass = m_pass;
+	command.program = m_pProgram;
+	command.material = m_material;
+	command.texture = texture;
+	command.vao = vao;
+	command.mode = mode;
+	command.first = first;
+	command.count = count;
+	command.indexType = indexType;
+	command.instanceCount = instanceCount;
+	command.modelViewMatrix = modelViewMatrix;
+	m_commands.push_back(command);
+}
+
+// Programs are numbered in the order they are first seen.  There are only a handful, so a linear search is quickest.
+int CRenderQueue::ProgramId(CShaderProgram* program)
+{
+	for (size_t i = 0; i < m_programs.size(); i++) {
+		if (m_programs[i] == program)
+			return (int)i;
+	}
+	m_programs.push_back(program);
+	return (int)m_programs.size() - 1;
+}
+
+unsigned long long CRenderQueue::MakeKey(const RenderCommand& command)
+{
+	// Depth of the object's origin in front of the camera, scaled to the far plane
+	float depth = glm::clamp(-command.modelViewMatrix[3].z / m_farPlane, 0.0f, 1.0f);
+	unsigned int depthBits = (unsigned int)(depth * DEPTH_MAX);
+	if (command.pass == RENDER_PASS_TRANSPARENT)
+		depthBits = DEPTH_MAX - depthBits;
+
+	unsigned long long textureId = command.texture != NULL ? command.texture->GetTextureID() : 0;
+	unsigned long long key = 0;
+	key |= (unsigned long long)(command.pass & 0xF) << PASS_SHIFT;
+	key |= (unsigned long long)(ProgramId(command.program) & 0xFF) << PROGRAM_SHIFT;
+	key |= (unsigned long long)(command.material & 0xFF) << MATERIAL_SHIFT;
+	key |= (textureId & 0xFFF) << TEXTURE_SHIFT;
+	key |= (unsigned long long)(command.vao & 0xFFF) << VAO_SHIFT;
+	key |= depthBits;
+	return key;
+}
+
+// Least significant digit radix sort, a byte at a time.  The histograms of all eight bytes are counted in one pass, and
+// a byte that is the same in every key is skipped, which is common since most frames use few programs and materials.
+void CRenderQueue::Sort()
+{
+	PROFILE_ZONE("RenderQueue::Sort");
+
+	int numItems = (int)m_commands.size();
+	m_items.resize(numItems);
+	m_scratch.resize(numItems);
+
+	for (int i = 0; i < numItems; i++) {
+		m_items[i].key = MakeKey(m_commands[i]);
+		m_items[i].command = i;
+	}
+
+	int counts[8][256] = {};
+	for (int i = 0; i < numItems; i++) {
+		unsigned long long key = m_items[i].key;
+		for (int b = 0; b < 8; b++)
+			counts[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	SortItem* pSource = numItems > 0 ? &m_items[0] : NULL;
+	SortItem* pDestination = numItems > 0 ? &m_scratch[0] : NULL;
+	for (int b = 0; b < 8; b++) {
+		int shift = b * 8;
+		if (numItems == 0 || counts[b][(pSource[0].key >> shift) & 0xFF] == numItems)
+			continue;
+
+		int offsets[256];
+		int total = 0;
+		for (int d = 0; d < 256; d++) {
+			offsets[d] = total;
+			total += counts[b][d];
+		}
+		for (int i = 0; i < numItems; i++)
+			pDestination[offsets[(pSource[i].key >> shift) & 0xFF]++] = pSource[i];
+		swap(pSource, pDestination);
+	}
+
+	if (numItems > 0 && pSource != &m_items[0])
+		m_items.swap(m_scratch);
+}
+
+// Draw in key order.  Each piece of state is only set when it differs from the previous draw's.
+void CRenderQueue::Execute(CUniformBuffers* uniformBuffers)
+{
+	PROFILE_ZONE("RenderQueue::Execute");
+
+	CShaderProgram* pProgram = NULL;
+	UniformHandle<int> useTextureUniform;
+	int useTexture = -1;
+	int material = -1;
+	CTexture* pTexture = NULL;
+	GLuint vao = 0;
+	bool vaoBound = false;
+	bool instanced = false;
+
+	for (size_t i = 0; i < m_items.size(); i++) {
+		const RenderCommand& command = m_commands[m_items[i].command];
+
+		if (command.program != pProgram) {
+			pProgram = command.program;
+			pProgram->UseProgram();
+			useTextureUniform = pProgram->GetUniform<int>("bUseTexture");
+			useTexture = -1;
+		}
+
+		if (command.material != material) {
+			material = command.material;
+			uniformBuffers->SetMaterial(m_materials[material]);
+		}
+
+		int textured = command.texture != NULL ? 1 : 0;
+		if (textured != useTexture) {
+			useTexture = textured;
+			pProgram->SetUniform(useTextureUniform, useTexture);
+		}
+		if (command.texture != NULL && command.texture != pTexture) {
+			pTexture = command.texture;
+			pTexture->Bind(0);
+		}
+
+		if (!vaoBound || command.vao != vao) {
+			vao = command.vao;
+			vaoBound = true;
+			glBindVertexArray(vao);
+		}
+
+		uniformBuffers->SetObject(command.modelViewMatrix,
+			glm::transpose(glm::inverse(glm::mat3(command.modelViewMatrix))));
+
+		// Ordinary draws read the instance attributes' current values, which instanced draws may have disturbed
+		if (instanced && command.instanceCount == 0)
+			CInstanceBuffer::SetDefaultAttributes();
+		instanced = command.instanceCount > 0;
+
+		int indexSize = command.indexType == GL_UNSIGNED_INT ? 4 : command.indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+		const GLvoid* indices = (const GLvoid*)(size_t)(command.first * indexSize);
+		if (command.indexType == 0 && !instanced)
+			glDrawArrays(command.mode, command.first, command.count);
+		else if (command.indexType == 0)
+			glDrawArraysInstanced(command.mode, command.first, command.count, command.instanceCount);
+		else if (!instanced)
+			glDrawElements(command.mode, command.count, command.indexType, indices);
+		else
+			glDrawElementsInstanced(command.mode, command.count, command.indexType, indices, command.instanceCount);
+	}
+
+	if (instanced)
+		CInstanceBuffer::SetDefaultAttributes();
+	glBindVertexArray(0);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Common.h"
+#include "UniformBuffers.h"
+
+class CShaderProgram;
+class CTexture;
+
+// Passes are drawn in this order.  Opaque draws are sorted front to back within their state, so early depth testing
+// rejects more of what is behind; transparent draws are sorted back to front.
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE = 0,
+	RENDER_PASS_TRANSPARENT = 1,
+};
+
+// One draw call and the state it needs
+struct RenderCommand
+{
+	RenderPass pass;
+	CShaderProgram* program;
+	int material;					// Index returned by CRenderQueue::AddMaterial
+	CTexture* texture;				// Bound to unit 0, or NULL to draw untextured
+	GLuint vao;
+	GLenum mode;					// GL_TRIANGLES, GL_TRIANGLE_STRIP, ...
+	GLint first;					// First vertex, or first index for an indexed draw
+	GLsizei count;
+	GLenum indexType;				// GL_UNSIGNED_INT, ..., or 0 for glDrawArrays
+	GLsizei instanceCount;			// Instances read from the VAO's instance buffer, or 0 for an ordinary draw
+	glm::mat4 modelViewMatrix;
+};
+
+// Collects the frame's draws, then sorts them on a 64-bit key so that draws sharing a program, material, texture and
+// VAO run together, and executes them changing only the state that differs from the previous draw.  From the most to
+// the least significant bits the key holds
+//
+//		pass (4) | program (8) | material (8) | texture (12) | VAO (12) | depth (20)
+//
+// Textures and VAOs go in by their GL names, which are small and handed out in order, so only the low bits are kept.
+// Two objects that share those bits are still drawn correctly, just not grouped.
+//
+// Draws are described by the current pass, program and material, set before submitting, as with the matrix stack.
+class CRenderQueue
+{
+public:
+	CRenderQueue();
+	~CRenderQueue();
+
+	void Begin(float farPlane);		// Forget last frame's draws and materials; depth is measured up to farPlane
+
+	int AddMaterial(const MaterialUniforms& material);
+	const MaterialUniforms& GetMaterial(int material) const { return m_materials[material]; }
+	void SetPass(RenderPass pass);
+	void SetProgram(CShaderProgram* program);
+	void SetMaterial(int material);
+
+	void Submit(GLuint vao, CTexture* texture, GLenum mode, GLint first, GLsizei count, GLenum indexType,
+		const glm::mat4& modelViewMatrix, GLsizei instanceCount = 0);
+
+	void Sort();
+	void Execute(CUniformBuffers* uniformBuffers);
+
+	int GetNumDraws() const { return (int)m_commands.size(); }
+
+private:
+	struct SortItem
+	{
+		unsigned long long key;
+		int command;
+	};
+
+	int ProgramId(CShaderProgram* program);
+	unsigned long long MakeKey(const RenderCommand& command);
+
+	vector<RenderCommand> m_commands;
+	vector<SortItem> m_items;
+	vector<SortItem> m_scratch;				// Other half of the radix sort's ping-pong
+	vector<MaterialUniforms> m_materials;
+	vector<CShaderProgram*> m_programs;		// Programs seen so far; the index is the program's part of the key
+	RenderPass m_pass;
+	CShaderProgram* m_pProgram;
+	int m_material;
+	float m_farPlane;
+};
@@ -0,0 +1,238 @@
+#include "SegmentBvh.h"
+
+#include <algorithm>
+#include <float.h>
+
+// Parameters sampled on a segment to start Newton's method from, when there is no hint
+static const int CLOSEST_POINT_SAMPLES = 8;
+static const int MAX_CLOSEST_POINT_ITERATIONS = 10;
+static const int MAX_TREE_DEPTH = 64;
+
+// The search radius taken from a hint is widened by this much, so a search that finds the same point as the hint (to
+// rounding) does not have to be repeated
+static const float HINT_RADIUS_SCALE = 1.001f;
+static const float HINT_RADIUS_MARGIN = 1e-4f;
+
+CSegmentBvh::CSegmentBvh()
+{}
+
+CSegmentBvh::~CSegmentBvh()
+{}
+
+void CSegmentBvh::Clear()
+{
+	m_coefficients.clear();
+	m_segmentMin.clear();
+	m_segmentMax.clear();
+	m_order.clear();
+	m_slots.clear();
+	m_nodes.clear();
+}
+
+// Build the hierarchy top down, splitting each node at the median segment along its longest axis
+void CSegmentBvh::Build(const vector<glm::vec3>& coefficients)
+{
+	Clear();
+	int numSegments = (int)coefficients.size() / 4;
+	if (numSegments == 0)
+		return;
+
+	m_coefficients = coefficients;
+	m_segmentMin.resize(numSegments);
+	m_segmentMax.resize(numSegments);
+	m_order.resize(numSegments);
+	vector<glm::vec3> centres(numSegments);
+	for (int j = 0; j < numSegments; j++) {
+		const glm::vec3* c = &m_coefficients[4 * j];
+		glm::vec3 b0 = c[0];
+		glm::vec3 b1 = c[0] + c[1] / 3.0f;
+		glm::vec3 b2 = c[0] + (2.0f * c[1] + c[2]) / 3.0f;
+		glm::vec3 b3 = c[0] + c[1] + c[2] + c[3];
+		m_segmentMin[j] = glm::min(glm::min(b0, b1), glm::min(b2, b3));
+		m_segmentMax[j] = glm::max(glm::max(b0, b1), glm::max(b2, b3));
+		centres[j] = 0.5f * (m_segmentMin[j] + m_segmentMax[j]);
+		m_order[j] = j;
+	}
+
+	m_nodes.reserve(2 * numSegments);
+	m_nodes.resize(1);
+	BuildNode(0, 0, numSegments, centres);
+
+	// Store the segments in leaf order, so the segments of a leaf are next to each other in memory
+	vector<glm::vec3> segmentMin(numSegments), segmentMax(numSegments);
+	m_slots.resize(numSegments);
+	for (int i = 0; i < numSegments; i++) {
+		int j = m_order[i];
+		segmentMin[i] = m_segmentMin[j];
+		segmentMax[i] = m_segmentMax[j];
+		for (int k = 0; k < 4; k++)
+			m_coefficients[4 * i + k] = coefficients[4 * j + k];
+		m_slots[j] = i;
+	}
+	m_segmentMin.swap(segmentMin);
+	m_segmentMax.swap(segmentMax);
+}
+
+// Fill in node index for the segments m_order[first ... first + count - 1], creating its children as a pair
+void CSegmentBvh::BuildNode(int index, int first, int count, vector<glm::vec3>& centres)
+{
+	glm::vec3 boxMin = m_segmentMin[m_order[first]], boxMax = m_segmentMax[m_order[first]];
+	for (int i = first + 1; i < first + count; i++) {
+		boxMin = glm::min(boxMin, m_segmentMin[m_order[i]]);
+		boxMax = glm::max(boxMax, m_segmentMax[m_order[i]]);
+	}
+	m_nodes[index].boxMin = boxMin;
+	m_nodes[index].boxMax = boxMax;
+
+	if (count <= MAX_LEAF_SEGMENTS) {
+		m_nodes[index].first = first;
+		m_nodes[index].count = count;
+		return;
+	}
+
+	glm::vec3 extent = boxMax - boxMin;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	int* begin = &m_order[first];
+	int half = count / 2;
+	nth_element(begin, begin + half, begin + count,
+		[&centres, axis](int a, int b) { return centres[a][axis] < centres[b][axis]; });
+
+	int left = (int)m_nodes.size();
+	m_nodes.resize(left + 2);
+	m_nodes[index].first = left;
+	m_nodes[index].count = 0;
+	BuildNode(left, first, half, centres);
+	BuildNode(left + 1, first + half, count - half, centres);
+}
+
+// Squared distance from q to the nearest point of a box (zero inside it)
+float CSegmentBvh::BoxDistanceSquared(const glm::vec3& q, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	glm::vec3 d = glm::max(glm::max(boxMin - q, q - boxMax), glm::vec3(0.0f));
+	return glm::dot(d, d);
+}
+
+// Find the closest point to q on the segment in slot i and keep it if it beats the best so far.  The minimum of |P(t) - q|^2 is a
+// root of f(t) = (P(t) - q).P'(t).  It is bracketed around tStart, or around the best of a few samples if tStart is
+// negative, and found with Newton's method; a step that leaves the bracket is replaced by bisection, as in
+// CCatmullRom::ArcLengthToParameter.
+void CSegmentBvh::TestSegment(const glm::vec3& q, int i, float tStart, int& segment, float& t,
+	float& distanceSquared) const
+{
+	const glm::vec3* c = &m_coefficients[4 * i];
+	glm::vec3 a = c[0] - q;
+
+	float tBest = tStart;
+	if (tBest < 0.0f) {
+		float best = FLT_MAX;
+		for (int k = 0; k <= CLOSEST_POINT_SAMPLES; k++) {
+			float s = (float)k / CLOSEST_POINT_SAMPLES;
+			glm::vec3 p = a + s * (c[1] + s * (c[2] + s * c[3]));
+			float d2 = glm::dot(p, p);
+			if (d2 < best) {
+				best = d2;
+				tBest = s;
+			}
+		}
+	}
+
+	float tLow = max(tBest - 1.0f / CLOSEST_POINT_SAMPLES, 0.0f);
+	float tHigh = min(tBest + 1.0f / CLOSEST_POINT_SAMPLES, 1.0f);
+	for (int iteration = 0; iteration < MAX_CLOSEST_POINT_ITERATIONS; iteration++) {
+		glm::vec3 p = a + tBest * (c[1] + tBest * (c[2] + tBest * c[3]));
+		glm::vec3 dp = c[1] + (2.0f * c[2] + 3.0f * c[3] * tBest) * tBest;
+		glm::vec3 ddp = 2.0f * c[2] + 6.0f * tBest * c[3];
+		float f = glm::dot(p, dp);
+		float fPrime = glm::dot(dp, dp) + glm::dot(p, ddp);
+
+		// Test for convergence before bracketing, as the last step may land on the end of the bracket
+		float step = fPrime > 0.0f ? f / fPrime : 0.0f;
+		if (fPrime > 0.0f && fabsf(step) < 1e-6f) {
+			tBest = glm::clamp(tBest - step, 0.0f, 1.0f);
+			break;
+		}
+
+		if (f > 0.0f)
+			tHigh = tBest;
+		else
+			tLow = tBest;
+		float tNext = tBest - step;
+		if (fPrime <= 0.0f || tNext <= tLow || tNext >= tHigh)
+			tNext = 0.5f * (tLow + tHigh);
+		tBest = tNext;
+	}
+
+	glm::vec3 p = a + tBest * (c[1] + tBest * (c[2] + tBest * c[3]));
+	float d2 = glm::dot(p, p);
+	if (d2 < distanceSquared) {
+		distanceSquared = d2;
+		segment = m_order[i];
+		t = tBest;
+	}
+}
+
+bool CSegmentBvh::FindClosest(const glm::vec3& q, int hintSegment, float hintT, int& segment, float& t,
+	float& distanceSquared) const
+{
+	if (m_nodes.empty())
+		return false;
+
+	int numSegments = (int)m_segmentMin.size();
+	segment = -1;
+	t = 0.0f;
+	distanceSquared = FLT_MAX;
+
+	// A good first answer shrinks the search radius, so most of the tree is pruned straight away.  The point refined from
+	// the hint only sets that radius and is not itself kept:  every segment that could hold a closer point is still
+	// searched from its samples, as without a hint, so the hint cannot change the answer.  If nothing is found within the
+	// radius (the hint followed a local minimum the samples do not lead to, or the object has moved), the tree is searched
+	// again without it.
+	if (hintSegment >= 0 && hintSegment < numSegments) {
+		int hintSegmentFound = -1;
+		float hintTFound = 0.0f, hintDistanceSquared = FLT_MAX;
+		TestSegment(q, m_slots[hintSegment], glm::clamp(hintT, 0.0f, 1.0f), hintSegmentFound, hintTFound,
+			hintDistanceSquared);
+		distanceSquared = hintDistanceSquared * HINT_RADIUS_SCALE + HINT_RADIUS_MARGIN;
+		SearchTree(q, segment, t, distanceSquared);
+		if (segment >= 0)
+			return true;
+		distanceSquared = FLT_MAX;
+	}
+
+	SearchTree(q, segment, t, distanceSquared);
+	return segment >= 0;
+}
+
+// Search the tree for the closest point to q within sqrt(distanceSquared), which is reduced as closer points are found
+void CSegmentBvh::SearchTree(const glm::vec3& q, int& segment, float& t, float& distanceSquared) const
+{
+	// Depth-first, visiting the nearer child first and skipping boxes further away than the best point found
+	int stack[MAX_TREE_DEPTH];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node& node = m_nodes[stack[--stackSize]];
+		if (BoxDistanceSquared(q, node.boxMin, node.boxMax) >= distanceSquared)
+			continue;
+
+		if (node.count > 0) {
+			for (int i = node.first; i < node.first + node.count; i++) {
+				if (BoxDistanceSquared(q, m_segmentMin[i], m_segmentMax[i]) < distanceSquared)
+					TestSegment(q, i, -1.0f, segment, t, distanceSquared);
+			}
+			continue;
+		}
+
+		int left = node.first, right = node.first + 1;
+		float leftDistance = BoxDistanceSquared(q, m_nodes[left].boxMin, m_nodes[left].boxMax);
+		float rightDistance = BoxDistanceSquared(q, m_nodes[right].boxMin, m_nodes[right].boxMax);
+		if (leftDistance < rightDistance) {
+			stack[stackSize++] = right;
+			stack[stackSize++] = left;
+		}
+		else {
+			stack[stackSize++] = left;
+			stack[stackSize++] = right;
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Common.h"
+
+// Bounding volume hierarchy over the segments of a closed cubic spline, for finding the closest point on the spline
+// to a point in space.  Each segment is P(t) = a + bt + ct^2 + dt^3 on [0, 1], given by its four coefficients as in
+// CCatmullRom, and is bounded by the box around its Bezier control points (a cubic lies in their convex hull).
+class CSegmentBvh
+{
+public:
+	CSegmentBvh();
+	~CSegmentBvh();
+
+	void Build(const vector<glm::vec3>& coefficients);	// Four coefficients per segment
+	void Clear();
+
+	// Find the segment and parameter closest to q.  If hintSegment is a valid segment, the search starts by refining
+	// hintT on it, which usually leaves very little of the tree to visit for a point that has moved a little since the
+	// last query.  The hint only makes the search faster:  the answer is the same without it.  Returns false if the
+	// hierarchy is empty.
+	bool FindClosest(const glm::vec3& q, int hintSegment, float hintT, int& segment, float& t, float& distanceSquared) const;
+
+private:
+	struct Node
+	{
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+		int first;		// Leaf:  first entry in m_order.  Interior:  index of the left child (the right follows it).
+		int count;		// Leaf:  number of segments.  Interior:  0.
+	};
+
+	static const int MAX_LEAF_SEGMENTS = 2;
+
+	void BuildNode(int index, int first, int count, vector<glm::vec3>& centres);
+	void SearchTree(const glm::vec3& q, int& segment, float& t, float& distanceSquared) const;
+	void TestSegment(const glm::vec3& q, int i, float tStart, int& segment, float& t, float& distanceSquared) const;
+	static float BoxDistanceSquared(const glm::vec3& q, const glm::vec3& boxMin, const glm::vec3& boxMax);
+
+	// Segments are stored in slots, in leaf order
+	vector<glm::vec3> m_coefficients;	// Four per slot
+	vector<glm::vec3> m_segmentMin;		// Box around the segment in each slot
+	vector<glm::vec3> m_segmentMax;
+	vector<int> m_order;				// Segment in each slot
+	vector<int> m_slots;				// Slot of each segment
+	vector<Node> m_nodes;				// Root first
+};
@@ -1,5 +1,8 @@
 #include "Common.h"
 #include "shaders.h"
+#include "Profiler.h"
+
+#include <algorithm>
 
 
 
@@ -13,6 +16,8 @@ CShader::~CShader()
 // Loads a shader, stored as a text file with filename sFile.  The shader is of type iType (vertex, fragment, geometry, etc.)
 bool CShader::LoadShader(string sFile, int iType)
 {
+	PROFILE_ZONE("Shader::Load");
+
 	vector<string> sLines;
 
 	if(!GetLinesFromFile(sFile, false, &sLines)) {
@@ -169,6 +174,8 @@ bool CShaderProgram::AddShaderToProgram(CShader* shShader)
 // Performs final linkage of the OpenGL shader program
 bool CShaderProgram::LinkProgram()
 {
+	PROFILE_ZONE("ShaderProgram::Link");
+
 	glLinkProgram(m_uiProgram);
 	int iLinkStatus;
 	glGetProgramiv(m_uiProgram, GL_LINK_STATUS, &iLinkStatus);
@@ -185,9 +192,72 @@ bool CShaderProgram::LinkProgram()
 	}
 
 	m_bLinked = iLinkStatus == GL_TRUE;
+	if (m_bLinked)
+		ReflectUniforms();
 	return m_bLinked;
 }
 
+// Build the table of active uniforms.  An array is listed by OpenGL as "name[0]"; it is entered under that name and
+// under the bare name, so either can be looked up.  Members of uniform blocks have no location and are left out.
+void CShaderProgram::ReflectUniforms()
+{
+	m_uniforms.clear();
+
+	int iNumUniforms = 0, iMaxNameLength = 0;
+	glGetProgramiv(m_uiProgram, GL_ACTIVE_UNIFORMS, &iNumUniforms);
+	glGetProgramiv(m_uiProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &iMaxNameLength);
+	vector<char> sName(max(iMaxNameLength, 1));
+
+	for (int i = 0; i < iNumUniforms; i++) {
+		GLsizei iLength = 0;
+		GLint iSize = 0;
+		GLenum eType = 0;
+		glGetActiveUniform(m_uiProgram, i, (GLsizei)sName.size(), &iLength, &iSize, &eType, &sName[0]);
+
+		UniformInfo uniform;
+		uniform.sName.assign(&sName[0], iLength);
+		uniform.iLocation = glGetUniformLocation(m_uiProgram, uniform.sName.c_str());
+		if (uniform.iLocation < 0)
+			continue;
+		m_uniforms.push_back(uniform);
+
+		size_t iBracket = uniform.sName.find('[');
+		if (iBracket != string::npos) {
+			uniform.sName.erase(iBracket);
+			m_uniforms.push_back(uniform);
+		}
+	}
+
+	sort(m_uniforms.begin(), m_uniforms.end(), [](const UniformInfo& a, const UniformInfo& b) {
+		return a.sName < b.sName;
+	});
+}
+
+bool CShaderProgram::BindUniformBlock(const char* sName, int iBinding)
+{
+	GLuint uiIndex = glGetUniformBlockIndex(m_uiProgram, sName);
+	if (uiIndex == GL_INVALID_INDEX)
+		return false;
+	glUniformBlockBinding(m_uiProgram, uiIndex, iBinding);
+	return true;
+}
+
+int CShaderProgram::GetUniformLocation(const char* sName) const
+{
+	int iLow = 0, iHigh = (int)m_uniforms.size();
+	while (iLow < iHigh) {
+		int iMid = (iLow + iHigh) / 2;
+		int iCompare = strcmp(m_uniforms[iMid].sName.c_str(), sName);
+		if (iCompare == 0)
+			return m_uniforms[iMid].iLocation;
+		if (iCompare < 0)
+			iLow = iMid + 1;
+		else
+			iHigh = iMid;
+	}
+	return -1;
+}
+
 // Deletes the program and frees memory on the GPU
 void CShaderProgram::DeleteProgram()
 {
@@ -210,98 +280,136 @@ UINT CShaderProgram::GetProgramID()
 	return m_uiProgram;
 }
 
-// A collection of functions to set uniform variables inside shaders
+// A collection of functions to set uniform variables inside shaders.  Names are looked up in the table built at link
+// time, so there is no call into the driver beyond the glUniform itself.
 
 // Setting floats
 
-void CShaderProgram::SetUniform(string sName, float* fValues, int iCount)
+void CShaderProgram::SetUniform(const char* sName, float* fValues, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform1fv(iLoc, iCount, fValues);
 }
 
-void CShaderProgram::SetUniform(string sName, const float fValue)
+void CShaderProgram::SetUniform(const char* sName, const float fValue)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform1fv(iLoc, 1, &fValue);
 }
 
 // Setting vectors
 
-void CShaderProgram::SetUniform(string sName, glm::vec2* vVectors, int iCount)
+void CShaderProgram::SetUniform(const char* sName, glm::vec2* vVectors, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform2fv(iLoc, iCount, (GLfloat*)vVectors);
 }
 
-void CShaderProgram::SetUniform(string sName, const glm::vec2 vVector)
+void CShaderProgram::SetUniform(const char* sName, const glm::vec2& vVector)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform2fv(iLoc, 1, (GLfloat*)&vVector);
 }
 
-void CShaderProgram::SetUniform(string sName, glm::vec3* vVectors, int iCount)
+void CShaderProgram::SetUniform(const char* sName, glm::vec3* vVectors, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform3fv(iLoc, iCount, (GLfloat*)vVectors);
 }
 
-void CShaderProgram::SetUniform(string sName, const glm::vec3 vVector)
+void CShaderProgram::SetUniform(const char* sName, const glm::vec3& vVector)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform3fv(iLoc, 1, (GLfloat*)&vVector);
 }
 
-void CShaderProgram::SetUniform(string sName, glm::vec4* vVectors, int iCount)
+void CShaderProgram::SetUniform(const char* sName, glm::vec4* vVectors, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform4fv(iLoc, iCount, (GLfloat*)vVectors);
 }
 
-void CShaderProgram::SetUniform(string sName, const glm::vec4 vVector)
+void CShaderProgram::SetUniform(const char* sName, const glm::vec4& vVector)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform4fv(iLoc, 1, (GLfloat*)&vVector);
 }
 
 // Setting 3x3 matrices
 
-void CShaderProgram::SetUniform(string sName, glm::mat3* mMatrices, int iCount)
+void CShaderProgram::SetUniform(const char* sName, glm::mat3* mMatrices, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniformMatrix3fv(iLoc, iCount, FALSE, (GLfloat*)mMatrices);
 }
 
-void CShaderProgram::SetUniform(string sName, const glm::mat3 mMatrix)
+void CShaderProgram::SetUniform(const char* sName, const glm::mat3& mMatrix)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniformMatrix3fv(iLoc, 1, FALSE, (GLfloat*)&mMatrix);
 }
 
 // Setting 4x4 matrices
 
-void CShaderProgram::SetUniform(string sName, glm::mat4* mMatrices, int iCount)
+void CShaderProgram::SetUniform(const char* sName, glm::mat4* mMatrices, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniformMatrix4fv(iLoc, iCount, FALSE, (GLfloat*)mMatrices);
 }
 
-void CShaderProgram::SetUniform(string sName, const glm::mat4 mMatrix)
+void CShaderProgram::SetUniform(const char* sName, const glm::mat4& mMatrix)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniformMatrix4fv(iLoc, 1, FALSE, (GLfloat*)&mMatrix);
 }
 
 // Setting integers
 
-void CShaderProgram::SetUniform(string sName, int* iValues, int iCount)
+void CShaderProgram::SetUniform(const char* sName, int* iValues, int iCount)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform1iv(iLoc, iCount, iValues);
 }
 
-void CShaderProgram::SetUniform(string sName, const int iValue)
+void CShaderProgram::SetUniform(const char* sName, const int iValue)
 {
-	int iLoc = glGetUniformLocation(m_uiProgram, sName.c_str());
+	int iLoc = GetUniformLocation(sName);
 	glUniform1i(iLoc, iValue);
+}
+
+// Setting through handles
+
+void CShaderProgram::SetUniform(UniformHandle<float> uniform, const float fValue)
+{
+	glUniform1f(uniform.GetLocation(), fValue);
+}
+
+void CShaderProgram::SetUniform(UniformHandle<int> uniform, const int iValue)
+{
+	glUniform1i(uniform.GetLocation(), iValue);
+}
+
+void CShaderProgram::SetUniform(UniformHandle<glm::vec2> uniform, const glm::vec2& vVector)
+{
+	glUniform2fv(uniform.GetLocation(), 1, (GLfloat*)&vVector);
+}
+
+void CShaderProgram::SetUniform(UniformHandle<glm::vec3> uniform, const glm::vec3& vVector)
+{
+	glUniform3fv(uniform.GetLocation(), 1, (GLfloat*)&vVector);
+}
+
+void CShaderProgram::SetUniform(UniformHandle<glm::vec4> uniform, const glm::vec4& vVector)
+{
+	glUniform4fv(uniform.GetLocation(), 1, (GLfloat*)&vVector);
+}
+
+void CShaderProgram::SetUniform(UniformHandle<glm::mat3> uniform, const glm::mat3& mMatrix)
+{
+	glUniformMatrix3fv(uniform.GetLocation(), 1, FALSE, (GLfloat*)&mMatrix);
+}
+
+void CShaderProgram::SetUniform(UniformHandle<glm::mat4> uniform, const glm::mat4& mMatrix)
+{
+	glUniformMatrix4fv(uniform.GetLocation(), 1, FALSE, (GLfloat*)&mMatrix);
 }
\ No newline at end of file
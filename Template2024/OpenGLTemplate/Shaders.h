@@ -26,6 +26,23 @@ private:
 };
 
 
+// The location of a uniform of type T, looked up once with CShaderProgram::GetUniform so that setting it is a single
+// glUniform call.  A handle to a uniform the program does not have is invalid, and setting it does nothing.
+template <typename T>
+class UniformHandle
+{
+public:
+	UniformHandle() : m_iLocation(-1) {}
+	explicit UniformHandle(int iLocation) : m_iLocation(iLocation) {}
+
+	bool IsValid() const { return m_iLocation >= 0; }
+	int GetLocation() const { return m_iLocation; }
+
+private:
+	int m_iLocation;
+};
+
+
 // A class the provides a wrapper around an OpenGL shader program
 class CShaderProgram
 {
@@ -42,32 +59,59 @@ public:
 
 	UINT GetProgramID();
 
+	// Location of a uniform from the table built when the program was linked, or -1 if the program does not have it
+	int GetUniformLocation(const char* sName) const;
+	template <typename T>
+	UniformHandle<T> GetUniform(const char* sName) const { return UniformHandle<T>(GetUniformLocation(sName)); }
+
+	// Connect a uniform block to a binding point.  Returns false if the program has no such block.
+	bool BindUniformBlock(const char* sName, int iBinding);
+
 	// Setting vectors
-	void SetUniform(string sName, glm::vec2* vVectors, int iCount = 1);
-	void SetUniform(string sName, const glm::vec2 vVector);
-	void SetUniform(string sName, glm::vec3* vVectors, int iCount = 1);
-	void SetUniform(string sName, const glm::vec3 vVector);
-	void SetUniform(string sName, glm::vec4* vVectors, int iCount = 1);
-	void SetUniform(string sName, const glm::vec4 vVector);
+	void SetUniform(const char* sName, glm::vec2* vVectors, int iCount = 1);
+	void SetUniform(const char* sName, const glm::vec2& vVector);
+	void SetUniform(const char* sName, glm::vec3* vVectors, int iCount = 1);
+	void SetUniform(const char* sName, const glm::vec3& vVector);
+	void SetUniform(const char* sName, glm::vec4* vVectors, int iCount = 1);
+	void SetUniform(const char* sName, const glm::vec4& vVector);
 
 	// Setting floats
-	void SetUniform(string sName, float* fValues, int iCount = 1);
-	void SetUniform(string sName, const float fValue);
+	void SetUniform(const char* sName, float* fValues, int iCount = 1);
+	void SetUniform(const char* sName, const float fValue);
 
 	// Setting 3x3 matrices
-	void SetUniform(string sName, glm::mat3* mMatrices, int iCount = 1);
-	void SetUniform(string sName, const glm::mat3 mMatrix);
+	void SetUniform(const char* sName, glm::mat3* mMatrices, int iCount = 1);
+	void SetUniform(const char* sName, const glm::mat3& mMatrix);
 
 	// Setting 4x4 matrices
-	void SetUniform(string sName, glm::mat4* mMatrices, int iCount = 1);
-	void SetUniform(string sName, const glm::mat4 mMatrix);
+	void SetUniform(const char* sName, glm::mat4* mMatrices, int iCount = 1);
+	void SetUniform(const char* sName, const glm::mat4& mMatrix);
 
 	// Setting integers
-	void SetUniform(string sName, int* iValues, int iCount = 1);
-	void SetUniform(string sName, const int iValue);
+	void SetUniform(const char* sName, int* iValues, int iCount = 1);
+	void SetUniform(const char* sName, const int iValue);
+
+	// Setting through handles, for uniforms set on every draw.  The program must be in use.
+	void SetUniform(UniformHandle<float> uniform, const float fValue);
+	void SetUniform(UniformHandle<int> uniform, const int iValue);
+	void SetUniform(UniformHandle<glm::vec2> uniform, const glm::vec2& vVector);
+	void SetUniform(UniformHandle<glm::vec3> uniform, const glm::vec3& vVector);
+	void SetUniform(UniformHandle<glm::vec4> uniform, const glm::vec4& vVector);
+	void SetUniform(UniformHandle<glm::mat3> uniform, const glm::mat3& mMatrix);
+	void SetUniform(UniformHandle<glm::mat4> uniform, const glm::mat4& mMatrix);
 
 
 private:
+	// An active uniform, found by reflection when the program is linked
+	struct UniformInfo
+	{
+		string sName;
+		int iLocation;
+	};
+
+	void ReflectUniforms();
+
 	UINT m_uiProgram; // ID of program
 	bool m_bLinked; // Whether program was linked and is ready to use
+	vector<UniformInfo> m_uniforms; // Sorted by name, so a lookup is a binary search with no allocation
 };
\ No newline at end of file
@@ -4,10 +4,17 @@
 #define BUFFER_OFFSET(i) ((char *)NULL + (i))
 
 #include "Sphere.h"
+#include "RenderQueue.h"
+#include "InstanceBuffer.h"
 #include <math.h>
 
 CSphere::CSphere()
-{}
+{
+	m_vao = 0;
+	m_numTriangles = 0;
+	m_instancedVao = 0;
+	m_pInstances = NULL;
+}
 
 CSphere::~CSphere()
 {}
@@ -48,11 +55,13 @@ void CSphere::Create(string a_sDirectory, string a_sFilename, int slicesIn, int
 			m_vbo.AddVertexData(&v, sizeof(glm::vec3));
 			m_vbo.AddVertexData(&t, sizeof(glm::vec2));
 			m_vbo.AddVertexData(&n, sizeof(glm::vec3));
+			m_boundingBox.Include(v);
 
 			vertexCount++;
 
 		}
 	}
+	m_boundingSphere = BoundingSphere(m_boundingBox.Centre(), 1.0f);
 
 	// Compute indices and store in VBO
 	m_numTriangles = 0;
@@ -81,6 +90,13 @@ void CSphere::Create(string a_sDirectory, string a_sFilename, int slicesIn, int
 
 	m_vbo.UploadDataToGPU(GL_STATIC_DRAW);
 
+	SetVertexAttributes();
+}
+
+void CSphere::SetVertexAttributes()
+{
+	m_vbo.Bind();
+
 	GLsizei stride = 2*sizeof(glm::vec3)+sizeof(glm::vec2);
 
 	// Vertex positions
@@ -92,7 +108,16 @@ void CSphere::Create(string a_sDirectory, string a_sFilename, int slicesIn, int
 	// Normal vectors
 	glEnableVertexAttribArray(2);
 	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(sizeof(glm::vec3)+sizeof(glm::vec2)));
-	
+}
+
+void CSphere::CreateInstanced(CInstanceBuffer* pInstances)
+{
+	m_pInstances = pInstances;
+	glGenVertexArrays(1, &m_instancedVao);
+	glBindVertexArray(m_instancedVao);
+	SetVertexAttributes();
+	pInstances->SetAttributes();
+	glBindVertexArray(0);
 }
 
 // Render the sphere as a set of triangles
@@ -104,10 +129,35 @@ void CSphere::Render()
 
 }
 
+void CSphere::Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	queue->Submit(m_vao, &m_texture, GL_TRIANGLES, 0, m_numTriangles*3, GL_UNSIGNED_INT, modelViewMatrix);
+}
+
+// One draw for every instance in the buffer given to CreateInstanced
+void CSphere::RenderInstanced()
+{
+	if (m_pInstances->GetCount() == 0)
+		return;
+	glBindVertexArray(m_instancedVao);
+	m_texture.Bind();
+	glDrawElementsInstanced(GL_TRIANGLES, m_numTriangles*3, GL_UNSIGNED_INT, 0, m_pInstances->GetCount());
+	CInstanceBuffer::SetDefaultAttributes();
+}
+
+void CSphere::SubmitInstanced(CRenderQueue* queue, const glm::mat4& modelViewMatrix)
+{
+	if (m_pInstances->GetCount() > 0)
+		queue->Submit(m_instancedVao, &m_texture, GL_TRIANGLES, 0, m_numTriangles*3, GL_UNSIGNED_INT, modelViewMatrix,
+			m_pInstances->GetCount());
+}
+
 // Release memory on the GPU 
 void CSphere::Release()
 {
 	m_texture.Release();
 	glDeleteVertexArrays(1, &m_vao);
+	if (m_instancedVao != 0)
+		glDeleteVertexArrays(1, &m_instancedVao);
 	m_vbo.Release();
 }
\ No newline at end of file
@@ -2,6 +2,10 @@
 
 #include "Texture.h"
 #include "VertexBufferObjectIndexed.h"
+#include "Bounds.h"
+
+class CRenderQueue;
+class CInstanceBuffer;
 
 // Class for generating a unit sphere
 class CSphere
@@ -11,12 +15,24 @@ public:
 	~CSphere();
 	void Create(string directory, string front, int slicesIn, int stacksIn);
 	void Render();
+	void Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix);
+	void CreateInstanced(CInstanceBuffer* pInstances);	// A second VAO that also reads pInstances, for the instanced path
+	void RenderInstanced();
+	void SubmitInstanced(CRenderQueue* queue, const glm::mat4& modelViewMatrix);
+	const BoundingBox& GetBoundingBox() const { return m_boundingBox; }
+	const BoundingSphere& GetBoundingSphere() const { return m_boundingSphere; }
 	void Release();
 private:
+	void SetVertexAttributes();
+
 	UINT m_vao;
 	CVertexBufferObjectIndexed m_vbo;
 	CTexture m_texture;
 	string m_directory;
 	string m_filename;
 	int m_numTriangles;
+	UINT m_instancedVao;
+	CInstanceBuffer* m_pInstances;
+	BoundingBox m_boundingBox;		// Around the vertices, in object coordinates
+	BoundingSphere m_boundingSphere;
 };
\ No newline at end of file
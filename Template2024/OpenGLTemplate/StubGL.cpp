@@ -0,0 +1,77 @@
+#include "Common.h"
+#include "StubGL.h"
+
+// Do-nothing replacements for the entry points used by the benchmarked code.  Every program links, and has the
+// uniforms of mainShader, so CShaderProgram builds a realistic uniform table.
+
+static const char* g_stubUniforms[] = {
+	"matrices.projMatrix", "matrices.modelViewMatrix", "matrices.normalMatrix",
+	"light1.position", "light1.La", "light1.Ld", "light1.Ls",
+	"material1.Ma", "material1.Md", "material1.Ms", "material1.shininess",
+	"sampler0", "CubeMapTex", "bUseTexture", "renderSkybox",
+};
+static const int NUM_STUB_UNIFORMS = sizeof(g_stubUniforms) / sizeof(g_stubUniforms[0]);
+
+static GLuint GLAPIENTRY StubCreateProgram() { return 1; }
+static void GLAPIENTRY StubLinkProgram(GLuint) {}
+static void GLAPIENTRY StubUseProgram(GLuint) {}
+
+static void GLAPIENTRY StubGetProgramiv(GLuint, GLenum pname, GLint* params)
+{
+	if (pname == GL_LINK_STATUS)
+		*params = GL_TRUE;
+	else if (pname == GL_ACTIVE_UNIFORMS)
+		*params = NUM_STUB_UNIFORMS;
+	else if (pname == GL_ACTIVE_UNIFORM_MAX_LENGTH)
+		*params = 64;
+	else
+		*params = 0;
+}
+
+static void GLAPIENTRY StubGetActiveUniform(GLuint, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size,
+	GLenum* type, GLchar* name)
+{
+	*length = (GLsizei)min(strlen(g_stubUniforms[index]), (size_t)bufSize - 1);
+	memcpy(name, g_stubUniforms[index], *length);
+	name[*length] = '\0';
+	*size = 1;
+	*type = GL_FLOAT;
+}
+
+static GLint GLAPIENTRY StubGetUniformLocation(GLuint, const GLchar* name)
+{
+	for (int i = 0; i < NUM_STUB_UNIFORMS; i++) {
+		if (strcmp(g_stubUniforms[i], name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+static void GLAPIENTRY StubUniform1i(GLint, GLint) {}
+static void GLAPIENTRY StubUniform1f(GLint, GLfloat) {}
+static void GLAPIENTRY StubUniform1iv(GLint, GLsizei, const GLint*) {}
+static void GLAPIENTRY StubUniform1fv(GLint, GLsizei, const GLfloat*) {}
+static void GLAPIENTRY StubUniform2fv(GLint, GLsizei, const GLfloat*) {}
+static void GLAPIENTRY StubUniform3fv(GLint, GLsizei, const GLfloat*) {}
+static void GLAPIENTRY StubUniform4fv(GLint, GLsizei, const GLfloat*) {}
+static void GLAPIENTRY StubUniformMatrix3fv(GLint, GLsizei, GLboolean, const GLfloat*) {}
+static void GLAPIENTRY StubUniformMatrix4fv(GLint, GLsizei, GLboolean, const GLfloat*) {}
+
+void InstallStubGL()
+{
+	glCreateProgram = StubCreateProgram;
+	glLinkProgram = StubLinkProgram;
+	glUseProgram = StubUseProgram;
+	glGetProgramiv = StubGetProgramiv;
+	glGetActiveUniform = StubGetActiveUniform;
+	glGetUniformLocation = StubGetUniformLocation;
+	glUniform1i = StubUniform1i;
+	glUniform1f = StubUniform1f;
+	glUniform1iv = StubUniform1iv;
+	glUniform1fv = StubUniform1fv;
+	glUniform2fv = StubUniform2fv;
+	glUniform3fv = StubUniform3fv;
+	glUniform4fv = StubUniform4fv;
+	glUniformMatrix3fv = StubUniformMatrix3fv;
+	glUniformMatrix4fv = StubUniformMatrix4fv;
+}
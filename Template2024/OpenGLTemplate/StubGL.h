@@ -0,0 +1,5 @@
+#pragma once
+
+// Points the OpenGL entry points that GLEW would normally load at functions that do nothing, so that code which calls
+// OpenGL (for example CShaderProgram::SetUniform) can be timed without a context or a GPU.  Only for benchmarking.
+void InstallStubGL();
@@ -1,6 +1,7 @@
 #include "Common.h"
 
 #include "texture.h"
+#include "Profiler.h"
 
 #include "include\freeimage\FreeImage.h"
 #pragma comment(lib, "lib/FreeImage.lib")
@@ -38,6 +39,8 @@ void CTexture::CreateFromData(BYTE* data, int width, int height, int bpp, GLenum
 // Loads a 2D texture given the filename (sPath).  bGenerateMipMaps will generate a mipmapped texture if true
 bool CTexture::Load(string path, bool generateMipMaps)
 {
+	PROFILE_ZONE("Texture::Load");
+
 	FREE_IMAGE_FORMAT fif = FIF_UNKNOWN;
 	FIBITMAP* dib(0);
 
@@ -119,4 +122,9 @@ int CTexture::GetHeight()
 int CTexture::GetBPP()
 {
 	return m_bpp;
+}
+
+UINT CTexture::GetTextureID()
+{
+	return m_textureID;
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ public:
 	int GetWidth();
 	int GetHeight();
 	int GetBPP();
+	UINT GetTextureID();
 
 	void Release();
 
@@ -0,0 +1,107 @@
+#include "TrackBroadphase.h"
+
+#include <algorithm>
+
+CTrackBroadphase::CTrackBroadphase()
+{
+	m_trackLength = 0.0f;
+}
+
+CTrackBroadphase::~CTrackBroadphase()
+{}
+
+// Distance d on the first lap; d itself may be negative or several laps on
+float CTrackBroadphase::Wrap(float d)
+{
+	float wrapped = d - floorf(d / m_trackLength) * m_trackLength;
+	return wrapped < m_trackLength ? wrapped : 0.0f;
+}
+
+void CTrackBroadphase::Build(CEntityStore& store, float trackLength)
+{
+	m_trackLength = trackLength;
+	for (int kind = 0; kind < NUM_ENTITY_KINDS; kind++) {
+		vector<Entry>& entries = m_entries[kind];
+		entries.clear();
+		if (trackLength <= 0.0f)
+			continue;
+
+		const EntityArchetype& archetype = store.Archetype((EntityKind)kind);
+		entries.resize(archetype.Count());
+		for (int i = 0; i < archetype.Count(); i++) {
+			entries[i].distance = Wrap(archetype.distances[i]);
+			entries[i].handle = store.Handle((EntityKind)kind, i);
+		}
+		sort(entries.begin(), entries.end());
+	}
+}
+
+void CTrackBroadphase::UpdateVehicles(CEntityStore& store)
+{
+	if (m_trackLength <= 0.0f)
+		return;
+
+	vector<Entry>& entries = m_entries[ENTITY_VEHICLE];
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (store.IsValid(entries[i].handle))
+			entries[i].distance = Wrap(store.Distance(entries[i].handle));
+	}
+
+	for (size_t i = 1; i < entries.size(); i++) {
+		Entry entry = entries[i];
+		size_t j = i;
+		for (; j > 0 && entry.distance < entries[j - 1].distance; j--)
+			entries[j] = entries[j - 1];
+		entries[j] = entry;
+	}
+}
+
+// Removing keeps the order, so the list stays sorted
+void CTrackBroadphase::RemoveStale(CEntityStore& store, EntityKind kind)
+{
+	vector<Entry>& entries = m_entries[kind];
+	size_t numKept = 0;
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (store.IsValid(entries[i].handle))
+			entries[numKept++] = entries[i];
+	}
+	entries.resize(numKept);
+}
+
+void CTrackBroadphase::Query(EntityKind kind, float d, float window, CEntityStore& store,
+	vector<EntityHandle>& candidates)
+{
+	const vector<Entry>& entries = m_entries[kind];
+	if (entries.empty())
+		return;
+
+	// A window as long as the lap covers everything; otherwise it overlaps the start line on at most one side
+	if (2.0f * window >= m_trackLength) {
+		QueryRange(entries, 0.0f, m_trackLength, store, candidates);
+		return;
+	}
+	float centre = Wrap(d);
+	float low = centre - window, high = centre + window;
+	if (low < 0.0f) {
+		QueryRange(entries, low + m_trackLength, m_trackLength, store, candidates);
+		low = 0.0f;
+	}
+	if (high > m_trackLength) {
+		QueryRange(entries, 0.0f, high - m_trackLength, store, candidates);
+		high = m_trackLength;
+	}
+	QueryRange(entries, low, high, store, candidates);
+}
+
+// Entries with low <= distance <= high, skipping any that have been destroyed since the last RemoveStale
+void CTrackBroadphase::QueryRange(const vector<Entry>& entries, float low, float high, CEntityStore& store,
+	vector<EntityHandle>& candidates)
+{
+	Entry key;
+	key.distance = low;
+	vector<Entry>::const_iterator it = lower_bound(entries.begin(), entries.end(), key);
+	for (; it != entries.end() && it->distance <= high; ++it) {
+		if (store.IsValid(it->handle))
+			candidates.push_back(it->handle);
+	}
+}
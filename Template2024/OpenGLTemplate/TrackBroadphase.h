@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Common.h"
+#include "EntityStore.h"
+
+// Collision broadphase for entities on the track.  Everything lives along the centreline, so each archetype is kept as
+// a list sorted by distance around the lap, and the entities near a distance are found by binary search and a short
+// scan (sweep and prune in one dimension), wrapping around the start line.  Finding the candidates near a vehicle
+// costs O(log n + k) rather than a test against every entity.
+//
+// Pickups do not move, so their lists are only sorted in Build.  Vehicle distances change every update, and
+// UpdateVehicles re-sorts their list with an insertion sort, which is linear when the order has barely changed.
+class CTrackBroadphase
+{
+public:
+	CTrackBroadphase();
+	~CTrackBroadphase();
+
+	void Build(CEntityStore& store, float trackLength);	// Every entity in the store, on a lap of trackLength
+	void UpdateVehicles(CEntityStore& store);			// Pick up the vehicles' new distances
+	void RemoveStale(CEntityStore& store, EntityKind kind);	// Forget entities that have been destroyed
+
+	// Append to candidates every live entity of kind whose distance is within window of d, either way around the lap.
+	// The caller makes the exact test; window must allow for distances along the centreline being longer than the
+	// straight-line distance between entities beside it on the inside of a corner.
+	void Query(EntityKind kind, float d, float window, CEntityStore& store, vector<EntityHandle>& candidates);
+
+private:
+	struct Entry
+	{
+		float distance;			// Wrapped into [0, m_trackLength)
+		EntityHandle handle;
+
+		bool operator<(const Entry& other) const { return distance < other.distance; }
+	};
+
+	float Wrap(float d);
+	void QueryRange(const vector<Entry>& entries, float low, float high, CEntityStore& store,
+		vector<EntityHandle>& candidates);
+
+	vector<Entry> m_entries[NUM_ENTITY_KINDS];
+	float m_trackLength;
+};
@@ -0,0 +1,215 @@
+#include "TrackFile.h"
+#include "Profiler.h"
+
+#include <fstream>
+
+static bool g_consoleErrors = false;
+
+static void ShowTrackError(const char* error, string filename)
+{
+	if (g_consoleErrors) {
+		fprintf(stderr, "%s: %s\n", error, filename.c_str());
+		return;
+	}
+
+	char message[1024];
+	sprintf_s(message, "%s\n%s\n", error, filename.c_str());
+	MessageBox(NULL, message, "Error", MB_ICONERROR);
+}
+
+CTrackFile::CTrackFile()
+{
+	m_arcLengthSubdivisions = 0;
+}
+
+CTrackFile::~CTrackFile()
+{}
+
+void CTrackFile::SetConsoleErrors(bool console)
+{
+	g_consoleErrors = console;
+}
+
+void CTrackFile::Clear()
+{
+	m_controlPoints.clear();
+	m_upVectors.clear();
+	m_distances.clear();
+	m_subdivisionDistances.clear();
+	m_arcLengthSubdivisions = 0;
+}
+
+// Load a track, binary if the filename ends in .trk and text otherwise
+bool CTrackFile::Load(string filename)
+{
+	PROFILE_ZONE("CTrackFile::Load");
+
+	Clear();
+	size_t dot = filename.find_last_of('.');
+	string extension = dot == string::npos ? "" : filename.substr(dot);
+	for (size_t i = 0; i < extension.size(); i++)
+		extension[i] = (char)tolower(extension[i]);
+
+	bool loaded = extension == ".trk" ? LoadBinary(filename) : LoadText(filename);
+	if (!loaded)
+		Clear();
+	return loaded;
+}
+
+// Map the file and copy the arrays out of the view.  Every size is checked against the file size before anything is
+// read, so a truncated or corrupt file is rejected rather than read past the end of the view.
+bool CTrackFile::LoadBinary(string filename)
+{
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		ShowTrackError("Cannot open track", filename);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(TrackFileHeader)) {
+		CloseHandle(file);
+		ShowTrackError("Track file is too short", filename);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const BYTE* view = mapping != NULL ? (const BYTE*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (view == NULL) {
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		ShowTrackError("Cannot map track file", filename);
+		return false;
+	}
+
+	const char* error = NULL;
+	const TrackFileHeader* header = (const TrackFileHeader*)view;
+	if (memcmp(header->magic, "TRAK", 4) != 0)
+		error = "Not a track file";
+	else if (header->version != TRACK_FILE_VERSION)
+		error = "Unsupported track file version";
+	else if (header->numControlPoints < 4)
+		error = "A track needs at least four control points";
+	else if ((header->flags & TRACK_FILE_ARC_LENGTHS) && header->arcLengthSubdivisions == 0)
+		error = "Track file has an empty arc length table";
+
+	if (error == NULL) {
+		unsigned long long M = header->numControlPoints;
+		unsigned long long S = header->arcLengthSubdivisions;
+		unsigned long long size = sizeof(TrackFileHeader) + M * sizeof(glm::vec3);
+		if (header->flags & TRACK_FILE_UP_VECTORS)
+			size += M * sizeof(glm::vec3);
+		if (header->flags & TRACK_FILE_ARC_LENGTHS)
+			size += (M + 1) * sizeof(float) + (M * S + 1) * sizeof(float);
+		if ((unsigned long long)fileSize.QuadPart < size)
+			error = "Track file is truncated";
+	}
+
+	if (error == NULL) {
+		size_t M = header->numControlPoints;
+		const BYTE* p = view + sizeof(TrackFileHeader);
+		m_controlPoints.assign((const glm::vec3*)p, (const glm::vec3*)p + M);
+		p += M * sizeof(glm::vec3);
+		if (header->flags & TRACK_FILE_UP_VECTORS) {
+			m_upVectors.assign((const glm::vec3*)p, (const glm::vec3*)p + M);
+			p += M * sizeof(glm::vec3);
+		}
+		if (header->flags & TRACK_FILE_ARC_LENGTHS) {
+			size_t numSubdivisions = M * header->arcLengthSubdivisions + 1;
+			m_distances.assign((const float*)p, (const float*)p + M + 1);
+			p += (M + 1) * sizeof(float);
+			m_subdivisionDistances.assign((const float*)p, (const float*)p + numSubdivisions);
+			m_arcLengthSubdivisions = header->arcLengthSubdivisions;
+		}
+	}
+
+	UnmapViewOfFile(view);
+	CloseHandle(mapping);
+	CloseHandle(file);
+
+	if (error != NULL) {
+		ShowTrackError(error, filename);
+		return false;
+	}
+	return true;
+}
+
+// Read a text track, one control point (and optionally its upvector) per line
+bool CTrackFile::LoadText(string filename)
+{
+	ifstream file(filename.c_str());
+	if (!file) {
+		ShowTrackError("Cannot open track", filename);
+		return false;
+	}
+
+	string line;
+	int lineNumber = 0;
+	while (getline(file, line)) {
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#')
+			continue;
+
+		float v[6];
+		int n = sscanf_s(line.c_str(), "%f %f %f %f %f %f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]);
+		bool hasUp = n == 6;
+		if ((n != 3 && n != 6) || (!m_controlPoints.empty() && hasUp != !m_upVectors.empty())) {
+			char error[64];
+			sprintf_s(error, "Bad control point on line %d", lineNumber);
+			ShowTrackError(error, filename);
+			return false;
+		}
+
+		m_controlPoints.push_back(glm::vec3(v[0], v[1], v[2]));
+		if (hasUp)
+			m_upVectors.push_back(glm::vec3(v[3], v[4], v[5]));
+	}
+
+	if (m_controlPoints.size() < 4) {
+		ShowTrackError("A track needs at least four control points", filename);
+		return false;
+	}
+	return true;
+}
+
+// Write the track in binary form
+bool CTrackFile::Save(string filename)
+{
+	if (m_controlPoints.empty())
+		return false;
+
+	size_t M = m_controlPoints.size();
+	bool hasUp = m_upVectors.size() == M;
+	bool hasArcLengths = m_arcLengthSubdivisions > 0 && m_distances.size() == M + 1 &&
+		m_subdivisionDistances.size() == M * m_arcLengthSubdivisions + 1;
+
+	TrackFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "TRAK", 4);
+	header.version = TRACK_FILE_VERSION;
+	header.flags = (hasUp ? TRACK_FILE_UP_VECTORS : 0) | (hasArcLengths ? TRACK_FILE_ARC_LENGTHS : 0);
+	header.numControlPoints = (UINT)M;
+	header.arcLengthSubdivisions = hasArcLengths ? m_arcLengthSubdivisions : 0;
+
+	ofstream file(filename.c_str(), ios::binary);
+	if (!file) {
+		ShowTrackError("Cannot write track", filename);
+		return false;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&m_controlPoints[0], M * sizeof(glm::vec3));
+	if (hasUp)
+		file.write((const char*)&m_upVectors[0], M * sizeof(glm::vec3));
+	if (hasArcLengths) {
+		file.write((const char*)&m_distances[0], m_distances.size() * sizeof(float));
+		file.write((const char*)&m_subdivisionDistances[0], m_subdivisionDistances.size() * sizeof(float));
+	}
+	if (!file) {
+		ShowTrackError("Cannot write track", filename);
+		return false;
+	}
+	return true;
+}
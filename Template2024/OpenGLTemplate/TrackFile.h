@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Common.h"
+
+// Track files.  A binary track (.trk) is read through a memory-mapped view of the file and its arrays are copied
+// straight into place, so loading a huge track costs little more than reading it from disk.  Any other extension is
+// read as text, for authoring:  one control point per line as "x y z", or "x y z ux uy uz" with an upvector, with
+// blank lines and lines starting with # ignored.
+//
+// Binary layout (little-endian), with the arrays following the header in this order:
+//	TrackFileHeader
+//	glm::vec3	controlPoints[numControlPoints]
+//	glm::vec3	upVectors[numControlPoints]									if TRACK_FILE_UP_VECTORS
+//	float		distances[numControlPoints + 1]								if TRACK_FILE_ARC_LENGTHS
+//	float		subdivisionDistances[numControlPoints * subdivisions + 1]	if TRACK_FILE_ARC_LENGTHS
+struct TrackFileHeader
+{
+	char magic[4];					// "TRAK"
+	UINT version;					// TRACK_FILE_VERSION
+	UINT flags;
+	UINT numControlPoints;
+	UINT arcLengthSubdivisions;		// Quadrature pieces per segment in the arc length table, or 0
+	UINT reserved[3];
+};
+
+static const UINT TRACK_FILE_VERSION = 1;
+static const UINT TRACK_FILE_UP_VECTORS = 1;		// The file has an upvector for each control point
+static const UINT TRACK_FILE_ARC_LENGTHS = 2;		// The file has the arc length table, as built by CCatmullRom
+
+class CTrackFile
+{
+public:
+	CTrackFile();
+	~CTrackFile();
+
+	bool Load(string filename);			// Binary or text, by the extension
+	bool Save(string filename);			// Always binary
+
+	static void SetConsoleErrors(bool console);	// Write errors to stderr rather than showing a message box
+
+	vector<glm::vec3> m_controlPoints;
+	vector<glm::vec3> m_upVectors;				// Empty, or one per control point
+	vector<float> m_distances;					// Arc length table:  empty, or as in CCatmullRom
+	vector<float> m_subdivisionDistances;
+	int m_arcLengthSubdivisions;
+
+private:
+	bool LoadBinary(string filename);
+	bool LoadText(string filename);
+	void Clear();
+};
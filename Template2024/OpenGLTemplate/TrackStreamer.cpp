@@ -0,0 +1,235 @@
+#include "TrackStreamer.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+
+const float CTrackStreamer::CHUNK_LENGTH = 250.0f;
+const float CTrackStreamer::RING_SPACING = 5.0f;
+
+CTrackStreamer::CTrackStreamer()
+{
+	m_pTrack = NULL;
+	m_indexBuffer = 0;
+	m_indexType = GL_UNSIGNED_SHORT;
+	m_indexCount = 0;
+	m_numChunks = 0;
+	m_chunkLength = 0.0f;
+	m_ringsPerChunk = 0;
+	m_created = false;
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		m_slots[i].vao = 0;
+		m_slots[i].vbo = 0;
+		m_slots[i].chunk = -1;
+	}
+}
+
+CTrackStreamer::~CTrackStreamer()
+{
+	Release();
+}
+
+void CTrackStreamer::Create(CCatmullRom* pTrack, string textureFilename)
+{
+	Create(pTrack, textureFilename, CCatmullRom::DefaultTrackProfile());
+}
+
+// Divide the lap into chunks, make the slots and load the chunks around the start line.  The centreline of pTrack must
+// already have been computed.
+void CTrackStreamer::Create(CCatmullRom* pTrack, string textureFilename, const vector<TrackProfilePoint>& profile)
+{
+	PROFILE_ZONE("CTrackStreamer::Create");
+
+	Release();
+	float length = pTrack->Length();
+	if (length <= 0.0f || profile.size() < 2)
+		return;
+
+	m_pTrack = pTrack;
+	m_profile = profile;
+	m_numChunks = max(1, (int)ceilf(length / CHUNK_LENGTH));
+	m_chunkLength = length / m_numChunks;
+	m_ringsPerChunk = max(1, (int)(m_chunkLength / RING_SPACING + 0.5f));
+
+	m_texture.Load(textureFilename);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_S, GL_REPEAT);
+	m_texture.SetSamplerObjectParameter(GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// A chunk has one more ring than it has gaps between rings, so neighbouring chunks meet exactly
+	int numVertices = (m_ringsPerChunk + 1) * (int)profile.size();
+	vector<GLuint> indices;
+	CCatmullRom::ComputeTrackIndices(profile, m_ringsPerChunk + 1, indices);
+	m_indexCount = (unsigned int)indices.size();
+
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	if (numVertices <= 65536) {
+		vector<GLushort> shortIndices(indices.begin(), indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), &shortIndices[0], GL_STATIC_DRAW);
+		m_indexType = GL_UNSIGNED_SHORT;
+	}
+	else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+		m_indexType = GL_UNSIGNED_INT;
+	}
+
+	// Each slot has its own VAO and vertex buffer, sized for one chunk, and the shared index buffer
+	GLsizei stride = sizeof(TrackVertex);
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		Slot& slot = m_slots[i];
+		glGenVertexArrays(1, &slot.vao);
+		glBindVertexArray(slot.vao);
+		glGenBuffers(1, &slot.vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, slot.vbo);
+		glBufferData(GL_ARRAY_BUFFER, numVertices * sizeof(TrackVertex), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, 0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(TrackVertex, texCoord));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(TrackVertex, normal));
+		slot.chunk = -1;
+	}
+	glBindVertexArray(0);
+
+	m_created = true;
+	UpdateWindow(0.0f, NUM_SLOTS);
+}
+
+void CTrackStreamer::Update(float d)
+{
+	UpdateWindow(d, MAX_UPLOADS_PER_UPDATE);
+}
+
+// Chunks kept on each side of the centre chunk.  When the whole lap fits in the slots this reaches the chunk opposite
+// the centre, so every chunk is loaded; otherwise the window is the largest odd number of chunks the slots can hold.
+int CTrackStreamer::HalfWindow()
+{
+	if (m_numChunks <= NUM_SLOTS)
+		return m_numChunks / 2;
+	return (NUM_SLOTS - 1) / 2;
+}
+
+// Whether a chunk is within the window centred on chunk centre, counting around the lap in both directions
+bool CTrackStreamer::InWindow(int chunk, int centre)
+{
+	int distance = abs(chunk - centre);
+	distance = min(distance, m_numChunks - distance);
+	return distance <= HalfWindow();
+}
+
+// Free the slots of chunks that have left the window, then load missing chunks, nearest to d first
+void CTrackStreamer::UpdateWindow(float d, int maxUploads)
+{
+	if (!m_created)
+		return;
+
+	PROFILE_ZONE("CTrackStreamer::Update");
+
+	float length = m_numChunks * m_chunkLength;
+	float fLength = d - floorf(d / length) * length;
+	int centre = min((int)(fLength / m_chunkLength), m_numChunks - 1);
+
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		if (m_slots[i].chunk >= 0 && !InWindow(m_slots[i].chunk, centre))
+			m_slots[i].chunk = -1;
+	}
+
+	int numUploads = 0;
+	int halfWindow = HalfWindow();
+	for (int offset = 0; offset <= halfWindow && numUploads < maxUploads; offset++) {
+		for (int side = 0; side < 2 && numUploads < maxUploads; side++) {
+			// Ahead first, then behind
+			int chunk = ((centre + (side == 0 ? offset : -offset)) % m_numChunks + m_numChunks) % m_numChunks;
+			Slot* pFree = NULL;
+			bool resident = false;
+			for (int i = 0; i < NUM_SLOTS && !resident; i++) {
+				if (m_slots[i].chunk == chunk)
+					resident = true;
+				else if (m_slots[i].chunk < 0 && pFree == NULL)
+					pFree = &m_slots[i];
+			}
+			if (resident || pFree == NULL)
+				continue;
+			UploadChunk(*pFree, chunk);
+			numUploads++;
+		}
+	}
+}
+
+// Sweep the profile along one chunk and replace the slot's vertex data with it
+void CTrackStreamer::UploadChunk(Slot& slot, int chunk)
+{
+	m_vertices.clear();
+	m_pTrack->ComputeTrackRings(m_profile, chunk * m_chunkLength, m_chunkLength / m_ringsPerChunk, m_ringsPerChunk + 1,
+		m_vertices);
+
+	// Orphan the old storage first, so the driver need not wait for draws still using it
+	GLsizeiptr size = m_vertices.size() * sizeof(TrackVertex);
+	glBindBuffer(GL_ARRAY_BUFFER, slot.vbo);
+	glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, &m_vertices[0]);
+	slot.chunk = chunk;
+
+	BoundingBox box;
+	for (size_t i = 0; i < m_vertices.size(); i++)
+		box.Include(m_vertices[i].position);
+	slot.bounds = BoundingSphere(box.Centre(), 0.0f);
+	for (size_t i = 0; i < m_vertices.size(); i++)
+		slot.bounds.Include(m_vertices[i].position);
+}
+
+void CTrackStreamer::Render()
+{
+	if (!m_created)
+		return;
+
+	m_texture.Bind();
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		if (m_slots[i].chunk < 0)
+			continue;
+		glBindVertexArray(m_slots[i].vao);
+		glDrawElements(GL_TRIANGLES, m_indexCount, m_indexType, 0);
+	}
+	glBindVertexArray(0);
+}
+
+// The track is in world coordinates, so each chunk's bounds can be tested as they are
+void CTrackStreamer::Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix, const CFrustum& frustum)
+{
+	if (!m_created)
+		return;
+
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		if (m_slots[i].chunk >= 0 && frustum.IsVisible(m_slots[i].bounds))
+			queue->Submit(m_slots[i].vao, &m_texture, GL_TRIANGLES, 0, m_indexCount, m_indexType, modelViewMatrix);
+	}
+}
+
+int CTrackStreamer::NumResidentChunks()
+{
+	int numResident = 0;
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		if (m_slots[i].chunk >= 0)
+			numResident++;
+	}
+	return numResident;
+}
+
+void CTrackStreamer::Release()
+{
+	if (!m_created)
+		return;
+
+	for (int i = 0; i < NUM_SLOTS; i++) {
+		glDeleteVertexArrays(1, &m_slots[i].vao);
+		glDeleteBuffers(1, &m_slots[i].vbo);
+		m_slots[i].chunk = -1;
+	}
+	glDeleteBuffers(1, &m_indexBuffer);
+	m_texture.Release();
+	m_created = false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Common.h"
+#include "CatmullRom.h"
+#include "Texture.h"
+#include "Bounds.h"
+
+class CRenderQueue;
+class CFrustum;
+
+// Streams the track mesh around a distance along the track, normally the camera's.  The lap is cut into chunks of
+// equal length; the chunks within a window around the distance are built on the CPU and uploaded into a fixed ring of
+// VBO slots, and a chunk's slot is reused once it falls out of the window.  GPU memory and the work done at startup
+// depend on the window, not on the length of the track.
+class CTrackStreamer
+{
+public:
+	CTrackStreamer();
+	~CTrackStreamer();
+
+	void Create(CCatmullRom* pTrack, string textureFilename);	// Road with kerbs and low walls
+	void Create(CCatmullRom* pTrack, string textureFilename, const vector<TrackProfilePoint>& profile);
+	void Update(float d);		// Move the window to distance d, uploading at most MAX_UPLOADS_PER_UPDATE chunks
+	void Render();
+	void Submit(CRenderQueue* queue, const glm::mat4& modelViewMatrix, const CFrustum& frustum);	// One draw per visible chunk
+	void Release();
+
+	int NumResidentChunks();
+
+private:
+	static const int NUM_SLOTS = 16;				// Chunks held on the GPU at once
+	static const int MAX_UPLOADS_PER_UPDATE = 2;	// Spreads the work of a window move over several frames
+	static const float CHUNK_LENGTH;				// Target chunk length; the lap is divided into equal chunks near this
+	static const float RING_SPACING;				// Target distance between rings of profile vertices
+
+	struct Slot
+	{
+		GLuint vao;
+		GLuint vbo;
+		int chunk;			// Chunk held in the slot, or -1 if the slot is free
+		BoundingSphere bounds;	// Around the chunk's vertices, in world coordinates
+	};
+
+	void UpdateWindow(float d, int maxUploads);
+	void UploadChunk(Slot& slot, int chunk);
+	int HalfWindow();
+	bool InWindow(int chunk, int centre);
+
+	CCatmullRom* m_pTrack;
+	vector<TrackProfilePoint> m_profile;
+	CTexture m_texture;
+	Slot m_slots[NUM_SLOTS];
+	GLuint m_indexBuffer;		// Shared by every slot:  all chunks have the same topology
+	GLenum m_indexType;
+	unsigned int m_indexCount;
+	int m_numChunks;
+	float m_chunkLength;
+	int m_ringsPerChunk;
+	vector<TrackVertex> m_vertices;		// Scratch space for building a chunk
+	bool m_created;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free mailbox between one producer thread and one consumer thread.  The producer fills Back() and publishes it;
+// the consumer takes the most recently published buffer with Consume and reads it through Front().  Of the three
+// buffers, one belongs to each side and the third holds the latest published one, so neither side ever waits for the
+// other, and buffers the consumer was too slow to take are simply overwritten.
+template <typename T>
+class CTripleBuffer
+{
+public:
+	CTripleBuffer()
+	{
+		m_back = 0;
+		m_middle = 1;
+		m_front = 2;
+	}
+
+	T& Back() { return m_buffers[m_back]; }				// Producer only
+	const T& Front() const { return m_buffers[m_front]; }	// Consumer only
+
+	// Hand the back buffer over, and take the middle one to fill next
+	void Publish()
+	{
+		int previous = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+		m_back = previous & INDEX_MASK;
+	}
+
+	// Swap the front buffer for the latest published one.  Returns false, leaving Front() unchanged, if nothing has been
+	// published since the last call.
+	bool Consume()
+	{
+		if (!(m_middle.load(std::memory_order_acquire) & FRESH))
+			return false;
+		int previous = m_middle.exchange(m_front, std::memory_order_acq_rel);
+		m_front = previous & INDEX_MASK;
+		return true;
+	}
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH = 4;		// Set in m_middle when it holds a buffer the consumer has not seen
+
+	T m_buffers[3];
+	int m_back;						// Owned by the producer
+	int m_front;					// Owned by the consumer
+	std::atomic<int> m_middle;
+};
@@ -0,0 +1,162 @@
+#include "UniformBuffers.h"
+#include "Shaders.h"
+
+CUniformBuffers::CUniformBuffers()
+{
+	m_buffer = 0;
+	m_bPersistent = false;
+	m_pMapped = NULL;
+	m_alignment = 256;
+	m_frameCapacity = 0;
+	m_capacity = 0;
+	m_frame = 0;
+	m_offset = 0;
+	m_frameEnd = 0;
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++)
+		m_fences[i] = NULL;
+	m_bHasFrame = false;
+	m_bHasMaterial = false;
+}
+
+CUniformBuffers::~CUniformBuffers()
+{
+	Release();
+}
+
+void CUniformBuffers::Create(int frameCapacity)
+{
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_alignment);
+	m_alignment = max(m_alignment, 1);
+	m_frameCapacity = frameCapacity;
+	m_capacity = frameCapacity * FRAMES_IN_FLIGHT;
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	m_bPersistent = GLEW_ARB_buffer_storage != 0;
+	if (m_bPersistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, m_capacity, NULL, flags);
+		m_pMapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, m_capacity, flags);
+		m_bPersistent = m_pMapped != NULL;
+	}
+	if (!m_bPersistent)
+		glBufferData(GL_UNIFORM_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+
+	m_frame = 0;
+	m_offset = 0;
+	m_frameEnd = m_bPersistent ? m_frameCapacity : m_capacity;
+}
+
+void CUniformBuffers::Release()
+{
+	for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+		if (m_fences[i] != NULL)
+			glDeleteSync(m_fences[i]);
+		m_fences[i] = NULL;
+	}
+	if (m_pMapped != NULL) {
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		m_pMapped = NULL;
+	}
+	if (m_buffer != 0)
+		glDeleteBuffers(1, &m_buffer);
+	m_buffer = 0;
+}
+
+void CUniformBuffers::BindProgram(CShaderProgram* program)
+{
+	program->BindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+	program->BindUniformBlock("Material", MATERIAL_BLOCK_BINDING);
+	program->BindUniformBlock("Object", OBJECT_BLOCK_BINDING);
+}
+
+// Move on to the next part of the persistently mapped ring, once the GPU has finished the frame that last used it
+void CUniformBuffers::BeginFrame()
+{
+	if (!m_bPersistent)
+		return;
+
+	m_frame = (m_frame + 1) % FRAMES_IN_FLIGHT;
+	GLsync fence = m_fences[m_frame];
+	if (fence != NULL) {
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+			;
+		glDeleteSync(fence);
+		m_fences[m_frame] = NULL;
+	}
+	m_offset = m_frame * m_frameCapacity;
+	m_frameEnd = m_offset + m_frameCapacity;
+}
+
+void CUniformBuffers::EndFrame()
+{
+	if (m_bPersistent)
+		m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void CUniformBuffers::SetFrame(const FrameUniforms& frame)
+{
+	m_frameUniforms = frame;
+	m_bHasFrame = true;
+	Write(FRAME_BLOCK_BINDING, &frame, sizeof(frame));
+}
+
+void CUniformBuffers::SetMaterial(const MaterialUniforms& material)
+{
+	m_materialUniforms = material;
+	m_bHasMaterial = true;
+	Write(MATERIAL_BLOCK_BINDING, &material, sizeof(material));
+}
+
+void CUniformBuffers::SetObject(const glm::mat4& modelViewMatrix, const glm::mat3& normalMatrix)
+{
+	ObjectUniforms object;
+	object.modelViewMatrix = modelViewMatrix;
+	for (int i = 0; i < 3; i++)
+		object.normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
+	Write(OBJECT_BLOCK_BINDING, &object, sizeof(object));
+}
+
+// Copy the data to the next free range and bind that range to the block.  Running out of room in a frame is rare
+// enough that it simply waits for the GPU (persistent) or orphans the buffer (otherwise) and starts the range again.
+// The frame and material blocks are still bound to ranges that have just been reused or orphaned, so the last frame
+// and material are written again before carrying on; otherwise every later draw would read garbage from them.
+void CUniformBuffers::Write(GLuint binding, const void* data, int size)
+{
+	if (m_offset + size > m_frameEnd) {
+		if (m_bPersistent) {
+			glFinish();
+			m_offset = m_frame * m_frameCapacity;
+		} else {
+			glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+			glBufferData(GL_UNIFORM_BUFFER, m_capacity, NULL, GL_STREAM_DRAW);
+			m_offset = 0;
+		}
+
+		if (m_bHasFrame && binding != FRAME_BLOCK_BINDING)
+			Copy(FRAME_BLOCK_BINDING, &m_frameUniforms, sizeof(m_frameUniforms));
+		if (m_bHasMaterial && binding != MATERIAL_BLOCK_BINDING)
+			Copy(MATERIAL_BLOCK_BINDING, &m_materialUniforms, sizeof(m_materialUniforms));
+	}
+
+	Copy(binding, data, size);
+}
+
+void CUniformBuffers::Copy(GLuint binding, const void* data, int size)
+{
+	if (m_bPersistent) {
+		memcpy(m_pMapped + m_offset, data, size);
+	} else {
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		void* p = glMapBufferRange(GL_UNIFORM_BUFFER, m_offset, size, access);
+		if (p != NULL) {
+			memcpy(p, data, size);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+		}
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, m_offset, size);
+	m_offset += (size + m_alignment - 1) / m_alignment * m_alignment;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Common.h"
+
+class CShaderProgram;
+
+// Binding points of the uniform blocks shared by the shader programs
+enum UniformBlockBinding
+{
+	FRAME_BLOCK_BINDING = 0,		// uniform Frame:  projection and lights, written once per frame
+	MATERIAL_BLOCK_BINDING = 1,		// uniform Material:  reflectances, written when the material changes
+	OBJECT_BLOCK_BINDING = 2,		// uniform Object:  modelview and normal matrices, written for every object
+};
+
+// std140 layouts of the blocks, which must match their declarations in the shaders.  A vec3 takes the space of a
+// vec4, and a mat3 is three vec4 columns.
+struct LightUniforms
+{
+	glm::vec4 position;		// Eye coordinates
+	glm::vec3 La; float padLa;
+	glm::vec3 Ld; float padLd;
+	glm::vec3 Ls; float padLs;
+};
+
+struct FrameUniforms
+{
+	glm::mat4 projMatrix;
+	LightUniforms light1;
+	float time;				// Seconds, for animating instances
+	float padTime[3];
+};
+
+struct MaterialUniforms
+{
+	glm::vec3 Ma; float padMa;
+	glm::vec3 Md; float padMd;
+	glm::vec3 Ms;
+	float shininess;
+};
+
+struct ObjectUniforms
+{
+	glm::mat4 modelViewMatrix;
+	glm::vec4 normalMatrix[3];
+};
+
+// Uniform blocks shared by every shader program, so per-frame and per-material values are written once rather than
+// set on each program in turn.  Each write goes to the next free range of a ring buffer, which is then bound to the
+// block's binding point; the ranges written earlier in the frame stay untouched while the GPU may still read them.
+//
+// With ARB_buffer_storage the ring is mapped once and kept mapped, and a write is one memcpy.  The ring is split into
+// one part per frame in flight, each guarded by a fence.  Without it, each write maps its range unsynchronised, and
+// the buffer is orphaned when the ring wraps.
+class CUniformBuffers
+{
+public:
+	CUniformBuffers();
+	~CUniformBuffers();
+
+	void Create(int frameCapacity = 1 << 20);	// Bytes that can be written per frame
+	void Release();
+	void BindProgram(CShaderProgram* program);	// Connect the program's blocks, if it has them, to the binding points
+
+	void BeginFrame();
+	void EndFrame();
+
+	void SetFrame(const FrameUniforms& frame);
+	void SetMaterial(const MaterialUniforms& material);
+	void SetObject(const glm::mat4& modelViewMatrix, const glm::mat3& normalMatrix);
+
+	enum { FRAMES_IN_FLIGHT = 3 };
+
+private:
+	void Write(GLuint binding, const void* data, int size);
+	void Copy(GLuint binding, const void* data, int size);
+
+	GLuint m_buffer;
+	bool m_bPersistent;
+	unsigned char* m_pMapped;		// The whole ring, when persistently mapped
+	int m_alignment;				// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	int m_frameCapacity;
+	int m_capacity;
+	int m_frame;					// Part of the ring the current frame writes to, when persistently mapped
+	int m_offset;					// Next free byte
+	int m_frameEnd;					// End of the current frame's part
+	GLsync m_fences[FRAMES_IN_FLIGHT];
+	FrameUniforms m_frameUniforms;	// Last frame and material written, so they can be written again if the ring wraps
+	MaterialUniforms m_materialUniforms;
+	bool m_bHasFrame;
+	bool m_bHasMaterial;
+};
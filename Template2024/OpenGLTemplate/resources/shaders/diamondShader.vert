@@ -1,17 +1,49 @@
 #version 400
 
-uniform mat4 modelViewMatrix;
-//uniform mat4 viewMatrix;
-uniform mat4 projectionMatrix;
+// The same Frame and Object blocks as mainShader.vert, which must be declared identically to share their buffers
+struct LightInfo
+{
+	vec4 position;
+	vec3 La;
+	vec3 Ld;
+	vec3 Ls;
+};
+
+layout (std140) uniform Frame
+{
+	mat4 projMatrix;
+	LightInfo light1;
+	float time;
+};
+
+layout (std140) uniform Object
+{
+	mat4 modelViewMatrix;
+	mat3 normalMatrix;
+};
 
 
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec3 inColour;
 
+// Per-instance attributes, as in mainShader.vert
+layout (location = 3) in mat4 inInstanceMatrix;
+layout (location = 7) in vec4 inInstanceColour;
+layout (location = 8) in vec2 inInstanceAnimation;	// Phase, spin
+
 out vec3 vColour;
 
+mat3 InstanceRotation()
+{
+	float angle = inInstanceAnimation.x + inInstanceAnimation.y * time;
+	float c = cos(angle);
+	float s = sin(angle);
+	return mat3(c, 0.0f, -s, 0.0f, 1.0f, 0.0f, s, 0.0f, c);
+}
+
 void main()
 {
-	gl_Position = projectionMatrix * modelViewMatrix * vec4(inPosition, 1);
-	vColour = inColour;
+	vec4 modelPosition = inInstanceMatrix * vec4(InstanceRotation() * inPosition, 1);
+	gl_Position = projMatrix * modelViewMatrix * modelPosition;
+	vColour = inColour * inInstanceColour.rgb;
 }
\ No newline at end of file
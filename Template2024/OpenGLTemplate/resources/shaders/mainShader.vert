@@ -1,13 +1,5 @@
 #version 400 core
 
-// Structure for matrices
-uniform struct Matrices
-{
-	mat4 projMatrix;
-	mat4 modelViewMatrix; 
-	mat3 normalMatrix;
-} matrices;
-
 // Structure holding light information:  its position as well as ambient, diffuse, and specular colours
 struct LightInfo
 {
@@ -26,15 +18,36 @@ struct MaterialInfo
 	float shininess;
 };
 
-// Lights and materials passed in as uniform variables from client programme
-uniform LightInfo light1; 
-uniform MaterialInfo material1; 
+// Uniform blocks shared with the other programs (see UniformBuffers.h for their layouts):  the projection and lights
+// for the frame, the current material, and the matrices of the object being drawn
+layout (std140) uniform Frame
+{
+	mat4 projMatrix;
+	LightInfo light1;
+	float time;
+};
+
+layout (std140) uniform Material
+{
+	MaterialInfo material1;
+};
+
+layout (std140) uniform Object
+{
+	mat4 modelViewMatrix;
+	mat3 normalMatrix;
+};
 
 // Layout of vertex attributes in VBO
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in vec2 inCoord;
 layout (location = 2) in vec3 inNormal;
 
+// Per-instance attributes, from an instance buffer
+layout (location = 3) in mat4 inInstanceMatrix;
+layout (location = 7) in vec4 inInstanceColour;
+layout (location = 8) in vec2 inInstanceAnimation;	// Phase, spin
+
 // Vertex colour output to fragment shader -- using Gouraud (interpolated) shading
 out vec3 vColour;	// Colour computed using reflectance model
 out vec2 vTexCoord;	// Texture coordinate
@@ -63,6 +76,16 @@ vec3 PhongModel(vec4 eyePosition, vec3 eyeNorm)
 
 }
 
+// Turn of an instance about its own y axis (see InstanceBuffer.h).  Draws that are not instanced get an identity
+// instance matrix, white and no animation.
+mat3 InstanceRotation()
+{
+	float angle = inInstanceAnimation.x + inInstanceAnimation.y * time;
+	float c = cos(angle);
+	float s = sin(angle);
+	return mat3(c, 0.0f, -s, 0.0f, 1.0f, 0.0f, s, 0.0f, c);
+}
+
 // This is the entry point into the vertex shader
 void main()
 {	
@@ -70,15 +93,20 @@ void main()
 // Save the world position for rendering the skybox
 	worldPosition = inPosition;
 
+	// Place the instance.  Its matrix scales uniformly, so it can transform the normal too.
+	mat3 instanceRotation = InstanceRotation();
+	vec4 modelPosition = inInstanceMatrix * vec4(instanceRotation * inPosition, 1.0f);
+	vec3 modelNormal = mat3(inInstanceMatrix) * (instanceRotation * inNormal);
+
 	// Transform the vertex spatial position using 
-	gl_Position = matrices.projMatrix * matrices.modelViewMatrix * vec4(inPosition, 1.0f);
+	gl_Position = projMatrix * modelViewMatrix * modelPosition;
 	
 	// Get the vertex normal and vertex position in eye coordinates
-	vec3 vEyeNorm = normalize(matrices.normalMatrix * inNormal);
-	vec4 vEyePosition = matrices.modelViewMatrix * vec4(inPosition, 1.0f);
+	vec3 vEyeNorm = normalize(normalMatrix * modelNormal);
+	vec4 vEyePosition = modelViewMatrix * modelPosition;
 		
 	// Apply the Phong model to compute the vertex colour
-	vColour = PhongModel(vEyePosition, vEyeNorm);
+	vColour = PhongModel(vEyePosition, vEyeNorm) * inInstanceColour.rgb;
 	
 	// Pass through the texture coordinate
 	vTexCoord = inCoord;